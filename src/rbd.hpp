@@ -0,0 +1,784 @@
+// vim: ft=cpp
+
+#ifndef RBD_HPP
+#define RBD_HPP
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "rbdmap.h"
+
+/* Template counterparts of the generated containers for C++17. Every type keeps the layout of its generator, and */
+/* everything is defined in the header so calls inline across translation units without instantiation macros. */
+/* Elements are moved rather than copied, and trivially copyable elements are moved in bulk with memcpy/memmove. */
+
+namespace rbd {
+
+  /*=================================================================================================================*/
+  /* List                                                                                                            */
+  /*=================================================================================================================*/
+
+  /* List, laid out as `RBD_LIST_GEN_DEF`. Iterators are plain pointers, so they are contiguous and random access. */
+  template <typename T>
+  class List {
+    public:
+      using value_type = T;
+      using size_type = size_t;
+      using difference_type = ptrdiff_t;
+      using reference = T &;
+      using const_reference = const T &;
+      using pointer = T *;
+      using const_pointer = const T *;
+      using iterator = T *;
+      using const_iterator = const T *;
+
+      /* Construct a new list with initial capacity. */
+      explicit List(size_t cap = 0) : elems(static_cast<T *>(std::malloc(cap * sizeof(T)))), cap_(cap), len_(0) {}
+
+      /* Construct a copy of the list. */
+      List(const List &other) : List(other.len_) {
+        if constexpr (Trivial) {
+          if (other.len_) {
+            std::memcpy(elems, other.elems, other.len_ * sizeof(T));
+          }
+        } else {
+          std::uninitialized_copy(other.begin(), other.end(), elems);
+        }
+        len_ = other.len_;
+      }
+
+      /* Construct the list by taking the elements of the other, leaving it empty. */
+      List(List &&other) noexcept : elems(other.elems), cap_(other.cap_), len_(other.len_) {
+        other.elems = nullptr;
+        other.cap_ = 0;
+        other.len_ = 0;
+      }
+
+      /* Assign a copy of the other list. */
+      List &operator=(const List &other) {
+        if (this != &other) {
+          List copy(other);
+          swap(copy);
+        }
+        return *this;
+      }
+
+      /* Assign the elements of the other list, leaving it empty. */
+      List &operator=(List &&other) noexcept {
+        List moved(std::move(other));
+        swap(moved);
+        return *this;
+      }
+
+      /* Destruct the list, calling element destructor for each element. */
+      ~List() {
+        clear();
+        std::free(elems);
+      }
+
+      /* Swap the contents of two lists. */
+      void swap(List &other) noexcept {
+        std::swap(elems, other.elems);
+        std::swap(cap_, other.cap_);
+        std::swap(len_, other.len_);
+      }
+
+      /* Get reference to element at the index. */
+      T &at(size_t i) noexcept { return elems[i]; }
+      const T &at(size_t i) const noexcept { return elems[i]; }
+      T &operator[](size_t i) noexcept { return elems[i]; }
+      const T &operator[](size_t i) const noexcept { return elems[i]; }
+
+      /* Get the capacity of the list. */
+      size_t cap() const noexcept { return cap_; }
+
+      /* Get the length of the list. */
+      size_t len() const noexcept { return len_; }
+      size_t size() const noexcept { return len_; }
+
+      /* Check if the list is empty. */
+      bool empty() const noexcept { return !len_; }
+
+      /* Get the elements of the list. */
+      T *data() noexcept { return elems; }
+      const T *data() const noexcept { return elems; }
+
+      /* Get the first element of the list. */
+      T &front() noexcept { return elems[0]; }
+      const T &front() const noexcept { return elems[0]; }
+
+      /* Get the last element of the list. */
+      T &back() noexcept { return elems[len_ - 1]; }
+      const T &back() const noexcept { return elems[len_ - 1]; }
+
+      /* Reserve at least the provided capacity. */
+      void reserve(size_t cap) {
+        if (cap > cap_) {
+          reserveUnchecked(cap);
+        }
+      }
+
+      /* Resize the list to the provided length, value-constructing appended elements and destructing removed ones. */
+      void resize(size_t len) {
+        if (len > cap_) {
+          reserveUnchecked(len);
+        }
+        if (len > len_) {
+          std::uninitialized_value_construct(elems + len_, elems + len);
+        } else {
+          std::destroy(elems + len, elems + len_);
+        }
+        len_ = len;
+      }
+
+      /* Insert element at the provided position, resizing as needed. */
+      void insert(size_t i, const T &elem) { emplace(i, elem); }
+      void insert(size_t i, T &&elem) { emplace(i, std::move(elem)); }
+
+      /* Construct an element in place at the provided position, resizing as needed. */
+      template <typename... Args>
+      T &emplace(size_t i, Args &&...args) {
+        if constexpr (Trivial) {
+          T elem(std::forward<Args>(args)...);
+          if (len_ == cap_) {
+            reserveUnchecked(grown());
+          }
+          std::memmove(elems + i + 1, elems + i, (len_ - i) * sizeof(T));
+          len_++;
+          return *::new (static_cast<void *>(elems + i)) T(std::move(elem));
+        } else {
+          emplaceBack(std::forward<Args>(args)...);
+          std::rotate(elems + i, elems + len_ - 1, elems + len_);
+          return elems[i];
+        }
+      }
+
+      /* Push the provided element to the back of the list, resizing as needed. */
+      void pushBack(const T &elem) { emplaceBack(elem); }
+      void pushBack(T &&elem) { emplaceBack(std::move(elem)); }
+
+      /* Same as `pushBack`, named for `std::back_inserter`. */
+      void push_back(const T &elem) { emplaceBack(elem); }
+      void push_back(T &&elem) { emplaceBack(std::move(elem)); }
+
+      /* Construct an element in place at the back of the list, resizing as needed. */
+      template <typename... Args>
+      T &emplaceBack(Args &&...args) {
+        if (len_ == cap_) {
+          return emplaceBackGrow(std::forward<Args>(args)...);
+        }
+        return *::new (static_cast<void *>(elems + len_++)) T(std::forward<Args>(args)...);
+      }
+
+      /* Remove the element at the end of the list. */
+      void popBack() noexcept {
+        std::destroy_at(elems + --len_);
+      }
+
+      /* Clear all elements and set length to zero, calling element destructor for each element. */
+      void clear() noexcept {
+        std::destroy(elems, elems + len_);
+        len_ = 0;
+      }
+
+      /* Erase the provided element, calling element destructor. */
+      void erase(size_t i) {
+        if constexpr (Trivial) {
+          std::memmove(elems + i, elems + i + 1, (len_ - i - 1) * sizeof(T));
+        } else {
+          std::move(elems + i + 1, elems + len_, elems + i);
+          std::destroy_at(elems + len_ - 1);
+        }
+        len_--;
+      }
+
+      /* Keep only the elements matching the predicate in one pass, calling element destructor for the rest. Returns */
+      /* the number erased. */
+      template <typename Pred>
+      size_t retain(Pred pred) { return filter(pred, true); }
+
+      /* Erase the elements matching the predicate in one pass, calling element destructor. Returns the number erased. */
+      template <typename Pred>
+      size_t removeIf(Pred pred) { return filter(pred, false); }
+
+      /* Return iterator starting at first element. */
+      T *begin() noexcept { return elems; }
+      const T *begin() const noexcept { return elems; }
+
+      /* Return iterator starting after last element. */
+      T *end() noexcept { return elems + len_; }
+      const T *end() const noexcept { return elems + len_; }
+
+      /* Return iterator at the first element equal to the provided element, or the end if none is. */
+      T *find(const T &elem) noexcept { return std::find(begin(), end(), elem); }
+      const T *find(const T &elem) const noexcept { return std::find(begin(), end(), elem); }
+
+      /* Count the elements equal to the provided element. */
+      size_t count(const T &elem) const noexcept { return std::count(begin(), end(), elem); }
+
+      /* Checks if two lists are equal. */
+      bool operator==(const List &other) const { return std::equal(begin(), end(), other.begin(), other.end()); }
+      bool operator!=(const List &other) const { return !(*this == other); }
+
+    private:
+      static constexpr bool Trivial = std::is_trivially_copyable_v<T>;
+
+      T *elems;
+      size_t cap_;
+      size_t len_;
+
+      /* Get the capacity to grow to when full. */
+      size_t grown() const noexcept { return cap_ ? cap_ * 2 : 1; }
+
+      /* Reserve at least the provided capacity, assuming capacity is larger than current. */
+      void reserveUnchecked(size_t cap) {
+        if constexpr (Trivial) {
+          T *grown = static_cast<T *>(std::realloc(elems, cap * sizeof(T)));
+          if (!grown) {
+            throw std::bad_alloc();
+          }
+          elems = grown;
+        } else {
+          T *grown = static_cast<T *>(std::malloc(cap * sizeof(T)));
+          if (!grown) {
+            throw std::bad_alloc();
+          }
+          std::uninitialized_move(elems, elems + len_, grown);
+          std::destroy(elems, elems + len_);
+          std::free(elems);
+          elems = grown;
+        }
+        cap_ = cap;
+      }
+
+      /* Construct the element before growing, since the arguments may refer to elements of the list. */
+      template <typename... Args>
+      T &emplaceBackGrow(Args &&...args) {
+        T elem(std::forward<Args>(args)...);
+        reserveUnchecked(grown());
+        return *::new (static_cast<void *>(elems + len_++)) T(std::move(elem));
+      }
+
+      /* Compact the elements whose predicate result equals keep to the front, destructing the others. */
+      template <typename Pred>
+      size_t filter(Pred &pred, bool keep) {
+        size_t j = 0;
+        for (size_t i = 0; i < len_; i++) {
+          if (static_cast<bool>(pred(elems[i])) == keep) {
+            if (i != j) {
+              elems[j] = std::move(elems[i]);
+            }
+            j++;
+          }
+        }
+        std::destroy(elems + j, elems + len_);
+        size_t n = len_ - j;
+        len_ = j;
+        return n;
+      }
+  };
+
+  /*=================================================================================================================*/
+  /* Map                                                                                                             */
+  /*=================================================================================================================*/
+
+  /* Map, laid out as `RBD_MAP_GEN_DEF`: linear probing over `{typ, hash, key, val}` elements with a trailing occupied */
+  /* sentinel that stops iteration. Iterators are forward iterators over the occupied elements. */
+  template <typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+  class Map {
+    public:
+      /* Map element. The key and value are only alive while the element is occupied. */
+      struct Elem {
+        uint8_t typ;
+        size_t hash;
+        union { K key; };
+        union { V val; };
+
+        Elem() noexcept {}
+        ~Elem() {}
+      };
+
+      /* Map iterator. */
+      template <typename E>
+      class Iter {
+        public:
+          using iterator_category = std::forward_iterator_tag;
+          using value_type = Elem;
+          using difference_type = ptrdiff_t;
+          using pointer = E *;
+          using reference = E &;
+
+          /* Construct a new map iterator. */
+          constexpr Iter(E *at = nullptr) noexcept : elem(at) {}
+
+          /* Convert a mutable iterator to a constant one. */
+          constexpr operator Iter<const Elem>() const noexcept { return Iter<const Elem>(elem); }
+
+          /* Get the element at the current position. */
+          constexpr E &operator*() const noexcept { return *elem; }
+          constexpr E *operator->() const noexcept { return elem; }
+
+          /* Advance the map iterator to the next element. */
+          constexpr Iter &operator++() noexcept {
+            do {
+              elem++;
+            } while (elem->typ != RBD_MAP_ELEM_OCCUPIED);
+            return *this;
+          }
+
+          constexpr Iter operator++(int) noexcept {
+            Iter iter = *this;
+            ++*this;
+            return iter;
+          }
+
+          /* Check if two iterators point to the same element. */
+          constexpr bool operator==(const Iter &other) const noexcept { return elem == other.elem; }
+          constexpr bool operator!=(const Iter &other) const noexcept { return elem != other.elem; }
+
+        private:
+          friend class Map;
+
+          E *elem;
+      };
+
+      using key_type = K;
+      using mapped_type = V;
+      using value_type = Elem;
+      using size_type = size_t;
+      using iterator = Iter<Elem>;
+      using const_iterator = Iter<const Elem>;
+
+      /* Construct a new map with initial capacity. */
+      explicit Map(size_t cap = 0) : elems(alloc(cap)), cap_(cap), len_(0), erased(0) {}
+
+      /* Construct a copy of the map. */
+      Map(const Map &other) : Map(other.cap_) {
+        for (size_t i = 0; i < cap_; i++) {
+          const Elem &elem = other.elems[i];
+          if (elem.typ == RBD_MAP_ELEM_OCCUPIED) {
+            occupy(elems[i], elem.hash, elem.key, elem.val);
+          } else {
+            elems[i].typ = elem.typ;
+          }
+        }
+        len_ = other.len_;
+        erased = other.erased;
+      }
+
+      /* Construct the map by taking the elements of the other, leaving it empty. */
+      Map(Map &&other) noexcept : elems(other.elems), cap_(other.cap_), len_(other.len_), erased(other.erased) {
+        other.elems = nullptr;
+        other.cap_ = 0;
+        other.len_ = 0;
+        other.erased = 0;
+      }
+
+      /* Assign a copy of the other map. */
+      Map &operator=(const Map &other) {
+        if (this != &other) {
+          Map copy(other);
+          swap(copy);
+        }
+        return *this;
+      }
+
+      /* Assign the elements of the other map, leaving it empty. */
+      Map &operator=(Map &&other) noexcept {
+        Map moved(std::move(other));
+        swap(moved);
+        return *this;
+      }
+
+      /* Destruct the map, calling key and value destructors for each element. */
+      ~Map() {
+        if (elems) {
+          for (size_t i = 0; i < cap_; i++) {
+            release(elems[i]);
+          }
+          std::free(static_cast<void *>(elems));
+        }
+      }
+
+      /* Swap the contents of two maps. */
+      void swap(Map &other) noexcept {
+        std::swap(elems, other.elems);
+        std::swap(cap_, other.cap_);
+        std::swap(len_, other.len_);
+        std::swap(erased, other.erased);
+      }
+
+      /* Check if the map is empty. */
+      bool empty() const noexcept { return !len_; }
+
+      /* Get the capacity of the map. */
+      size_t cap() const noexcept { return cap_; }
+
+      /* Get the length of the map. */
+      size_t len() const noexcept { return len_; }
+      size_t size() const noexcept { return len_; }
+
+      /* Reserve at least the provided capacity. */
+      void reserve(size_t cap) {
+        if (cap > cap_) {
+          reserveUnchecked(cap);
+        }
+      }
+
+      /* Clear all elements and set length to zero, calling key and value destructors for each element. */
+      void clear() noexcept {
+        for (size_t i = 0; i < cap_; i++) {
+          release(elems[i]);
+          elems[i].typ = RBD_MAP_ELEM_UNUSED;
+        }
+        len_ = 0;
+        erased = 0;
+      }
+
+      /* Insert a new element into the map (must not exist). */
+      void insert(K key, V val) { emplace(std::move(key), std::move(val)); }
+
+      /* Same as `insert`, but constructing the value in place from the arguments. */
+      template <typename... Args>
+      V &emplace(K key, Args &&...args) {
+        if (full()) {
+          return emplaceGrow(std::move(key), std::forward<Args>(args)...);
+        }
+        return place(std::move(key), std::forward<Args>(args)...);
+      }
+
+      /* Replace an existing element in the map (must exist). */
+      void replace(const K &key, V val) { at(key) = std::move(val); }
+
+      /* Get the value of the provided key (must exist). */
+      V &at(const K &key) noexcept { return elems[locate(key)].val; }
+      const V &at(const K &key) const noexcept { return elems[locate(key)].val; }
+
+      /* Get the element of the provided key. */
+      iterator find(const K &key) noexcept { return iterator(&elems[probe(key)]); }
+      const_iterator find(const K &key) const noexcept { return const_iterator(&elems[probe(key)]); }
+
+      /* Check if the key exists in the map. */
+      bool contains(const K &key) const noexcept { return probe(key) != cap_; }
+
+      /* Erase the provided element (must exist). */
+      void erase(const K &key) noexcept { eraseAt(locate(key)); }
+
+      /* Erase the element at the iterator, returning an iterator to the next element. */
+      iterator erase(iterator iter) noexcept {
+        eraseAt(iter.elem - elems);
+        return ++iter;
+      }
+
+      /* Keep only the elements matching the predicate in one table sweep, calling key and value destructors for the */
+      /* rest. Returns the number erased. */
+      template <typename Pred>
+      size_t retain(Pred pred) { return filter(pred, true); }
+
+      /* Erase the elements matching the predicate in one table sweep, calling key and value destructors. Returns the */
+      /* number erased. */
+      template <typename Pred>
+      size_t removeIf(Pred pred) { return filter(pred, false); }
+
+      /* Return iterator starting at first element. */
+      iterator begin() noexcept { return iterator(first()); }
+      const_iterator begin() const noexcept { return const_iterator(first()); }
+
+      /* Return iterator starting after last element. */
+      iterator end() noexcept { return iterator(&elems[cap_]); }
+      const_iterator end() const noexcept { return const_iterator(&elems[cap_]); }
+
+      /* Check if two maps are equal. */
+      bool operator==(const Map &other) const {
+        if (len_ != other.len_) {
+          return false;
+        }
+        for (const Elem &elem : *this) {
+          size_t i = other.probe(elem.key);
+          if (i == other.cap_ || !(other.elems[i].val == elem.val)) {
+            return false;
+          }
+        }
+        return true;
+      }
+
+      bool operator!=(const Map &other) const { return !(*this == other); }
+
+    private:
+      static constexpr bool Trivial = std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>;
+
+      Elem *elems;
+      size_t cap_;
+      size_t len_;
+      size_t erased;
+
+      /* Allocate unused elements with the trailing sentinel. */
+      static Elem *alloc(size_t cap) {
+        Elem *elems = static_cast<Elem *>(std::malloc((cap + 1) * sizeof(Elem)));
+        if (!elems) {
+          throw std::bad_alloc();
+        }
+        for (size_t i = 0; i < cap; i++) {
+          elems[i].typ = RBD_MAP_ELEM_UNUSED;
+        }
+        elems[cap].typ = RBD_MAP_ELEM_OCCUPIED;
+        return elems;
+      }
+
+      /* Construct the key and value of an element, marking it occupied. */
+      template <typename Key, typename... Args>
+      static void occupy(Elem &elem, size_t hash, Key &&key, Args &&...args) {
+        ::new (static_cast<void *>(&elem.key)) K(std::forward<Key>(key));
+        ::new (static_cast<void *>(&elem.val)) V(std::forward<Args>(args)...);
+        elem.hash = hash;
+        elem.typ = RBD_MAP_ELEM_OCCUPIED;
+      }
+
+      /* Destruct the key and value of an element, if occupied. */
+      static void release(Elem &elem) noexcept {
+        if (elem.typ == RBD_MAP_ELEM_OCCUPIED) {
+          std::destroy_at(&elem.key);
+          std::destroy_at(&elem.val);
+        }
+      }
+
+      /* Get the first occupied element, or the sentinel. */
+      Elem *first() const noexcept {
+        Elem *elem = elems;
+        if (!elem) {
+          return elem;
+        }
+        while (elem->typ != RBD_MAP_ELEM_OCCUPIED) {
+          elem++;
+        }
+        return elem;
+      }
+
+      /* Check if occupied and erased elements fill two thirds of the table, leaving no room for one more element. */
+      bool full() const noexcept { return !cap_ || 3 * (len_ + erased) > 2 * cap_; }
+
+      /* Make room for one more element, assuming the table is full, doubling the capacity if live elements fill a */
+      /* third of it and otherwise rehashing at the same capacity to drop tombstones. */
+      void grow() { reserveUnchecked(!cap_ ? 1 : 3 * len_ > cap_ ? cap_ * 2 : cap_); }
+
+      /* Construct the value before growing, since the arguments may refer to values of the map. */
+      template <typename... Args>
+      V &emplaceGrow(K key, Args &&...args) {
+        V val(std::forward<Args>(args)...);
+        grow();
+        return place(std::move(key), std::move(val));
+      }
+
+      /* Construct an element in the first free slot of the key's probe sequence, assuming there is room. */
+      template <typename... Args>
+      V &place(K key, Args &&...args) {
+        size_t hash = Hash{}(key);
+        for (size_t i = hash % cap_; ; i = (i + 1) % cap_) {
+          if (elems[i].typ != RBD_MAP_ELEM_OCCUPIED) {
+            erased -= elems[i].typ == RBD_MAP_ELEM_ERASED;
+            occupy(elems[i], hash, std::move(key), std::forward<Args>(args)...);
+            len_++;
+            return elems[i].val;
+          }
+        }
+      }
+
+      /* Reserve provided capacity and rehash, assuming larger capacity than current. */
+      void reserveUnchecked(size_t cap) {
+        Elem *grown = alloc(cap);
+        for (size_t i = 0; i < cap_; i++) {
+          Elem &elem = elems[i];
+          if (elem.typ == RBD_MAP_ELEM_OCCUPIED) {
+            for (size_t j = elem.hash % cap; ; j = (j + 1) % cap) {
+              if (grown[j].typ != RBD_MAP_ELEM_OCCUPIED) {
+                if constexpr (Trivial) {
+                  std::memcpy(static_cast<void *>(&grown[j]), &elem, sizeof(Elem));
+                } else {
+                  occupy(grown[j], elem.hash, std::move(elem.key), std::move(elem.val));
+                  release(elem);
+                }
+                break;
+              }
+            }
+          }
+        }
+        std::free(static_cast<void *>(elems));
+        elems = grown;
+        cap_ = cap;
+        erased = 0;
+      }
+
+      /* Get the index of the provided key, or the capacity if it does not exist. */
+      size_t probe(const K &key) const noexcept {
+        if (!cap_) {
+          return 0;
+        }
+        size_t hash = Hash{}(key);
+        for (size_t i = 0, j = hash % cap_; i < cap_; i++, j = (j + 1) % cap_) {
+          if (elems[j].typ == RBD_MAP_ELEM_OCCUPIED && elems[j].hash == hash && Eq{}(elems[j].key, key)) {
+            return j;
+          } else if (elems[j].typ == RBD_MAP_ELEM_UNUSED) {
+            return cap_;
+          }
+        }
+        return cap_;
+      }
+
+      /* Get the index of the provided key, assuming it exists. */
+      size_t locate(const K &key) const noexcept {
+        size_t hash = Hash{}(key);
+        for (size_t i = hash % cap_; ; i = (i + 1) % cap_) {
+          if (elems[i].typ == RBD_MAP_ELEM_OCCUPIED && elems[i].hash == hash && Eq{}(elems[i].key, key)) {
+            return i;
+          }
+        }
+      }
+
+      /* Turn erased elements preceding an unused element back into unused elements, walking backward from the index. */
+      void reclaim(size_t i) noexcept {
+        if (elems[(i + 1) % cap_].typ != RBD_MAP_ELEM_UNUSED) {
+          return;
+        }
+        while (elems[i].typ == RBD_MAP_ELEM_ERASED) {
+          elems[i].typ = RBD_MAP_ELEM_UNUSED;
+          erased--;
+          i = (i + cap_ - 1) % cap_;
+        }
+      }
+
+      /* Erase the occupied element at the index. */
+      void eraseAt(size_t i) noexcept {
+        release(elems[i]);
+        elems[i].typ = RBD_MAP_ELEM_ERASED;
+        len_--;
+        erased++;
+        reclaim(i);
+      }
+
+      /* Erase the elements whose predicate result differs from keep, sweeping backward so that erased elements can */
+      /* be reclaimed in the same pass. */
+      template <typename Pred>
+      size_t filter(Pred &pred, bool keep) {
+        size_t n = 0;
+        for (size_t i = cap_; i-- > 0;) {
+          Elem &elem = elems[i];
+          if (elem.typ == RBD_MAP_ELEM_OCCUPIED && static_cast<bool>(pred(elem.key, elem.val)) != keep) {
+            release(elem);
+            elem.typ = RBD_MAP_ELEM_ERASED;
+            erased++;
+            n++;
+          }
+          if (elem.typ == RBD_MAP_ELEM_ERASED && elems[(i + 1) % cap_].typ == RBD_MAP_ELEM_UNUSED) {
+            elem.typ = RBD_MAP_ELEM_UNUSED;
+            erased--;
+          }
+        }
+        len_ -= n;
+        return n;
+      }
+  };
+
+  /*=================================================================================================================*/
+  /* Pool                                                                                                            */
+  /*=================================================================================================================*/
+
+  /* Object pool, laid out as `RBD_POOL_GEN_DEF`: slabs doubling in capacity with an intrusive free list threaded */
+  /* through freed objects. Unlike the generator, each pool is an object rather than a global. */
+  template <typename T>
+  class Pool {
+    static_assert(sizeof(T) >= sizeof(void *), "pool objects must be able to hold a free list link");
+
+    public:
+      /* Construct the object pool. */
+      explicit Pool(size_t cap = 64) : slabs(slab(cap, nullptr)), cap_(cap), len_(0), frees(nullptr) {}
+
+      Pool(const Pool &) = delete;
+      Pool &operator=(const Pool &) = delete;
+
+      /* Destruct the object pool, without calling destructors of objects still allocated. */
+      ~Pool() {
+        Slab *curr = slabs, *next;
+        while (curr) {
+          next = curr->next;
+          std::free(curr);
+          curr = next;
+        }
+      }
+
+      /* Allocate uninitialized storage for an object from the pool. */
+      T *alloc() {
+        if (frees != nullptr) {
+          T *elem = reinterpret_cast<T *>(frees);
+          frees = frees->next;
+          return elem;
+        }
+        if (len_ == cap_) {
+          cap_ = cap_ ? cap_ * 2 : 1;
+          len_ = 0;
+          slabs = slab(cap_, slabs);
+        }
+        return slabs->elems() + len_++;
+      }
+
+      /* Free storage for an object from the pool. */
+      void free(T *elem) noexcept {
+        frees = ::new (static_cast<void *>(elem)) Free{frees};
+      }
+
+      /* Allocate and construct an object in place from the pool. */
+      template <typename... Args>
+      T *make(Args &&...args) {
+        T *elem = alloc();
+        try {
+          return ::new (static_cast<void *>(elem)) T(std::forward<Args>(args)...);
+        } catch (...) {
+          free(elem);
+          throw;
+        }
+      }
+
+      /* Destruct an object and free its storage from the pool. */
+      void drop(T *elem) noexcept {
+        std::destroy_at(elem);
+        free(elem);
+      }
+
+    private:
+      /* Pool free node. */
+      struct Free {
+        Free *next;
+      };
+
+      /* Pool slab node, aligned so that its objects follow it. */
+      struct alignas(alignof(T) > alignof(void *) ? alignof(T) : alignof(void *)) Slab {
+        Slab *next;
+
+        T *elems() noexcept { return reinterpret_cast<T *>(this + 1); }
+      };
+
+      Slab *slabs;
+      size_t cap_;
+      size_t len_;
+      Free *frees;
+
+      /* Allocate a slab for the provided capacity. */
+      static Slab *slab(size_t cap, Slab *next) {
+        Slab *mem = static_cast<Slab *>(std::malloc(sizeof(Slab) + cap * sizeof(T)));
+        if (!mem) {
+          throw std::bad_alloc();
+        }
+        mem->next = next;
+        return mem;
+      }
+  };
+
+}
+
+#endif // RBD_HPP
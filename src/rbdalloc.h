@@ -0,0 +1,389 @@
+// vim: ft=c
+
+#ifndef RBD_ALLOC_H
+#define RBD_ALLOC_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "rbddef.h"
+
+/* Size and alignment of an allocator page. Freeing finds the page header by masking the pointer. */
+#define RBD_ALLOC_PAGE_SIZE ((size_t)1 << 18)
+
+/* Size of the header at the start of every page, keeping objects 16-byte aligned. */
+#define RBD_ALLOC_HEADER_SIZE RBD_CACHE_LINE
+
+/* Largest size served from a size class; larger objects get a dedicated allocation. */
+#define RBD_ALLOC_MAX_SIZE ((size_t)1 << 15)
+
+/* Number of size classes: 16 to 128 bytes in steps of 16, then four classes per doubling up to the maximum size. */
+#define RBD_ALLOC_CLASSES 40
+
+/* Size class marking a page that holds a single large object. */
+#define RBD_ALLOC_LARGE RBD_ALLOC_CLASSES
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#ifndef MREMAP_FIXED
+#include <linux/mman.h>
+#endif
+#define RBD_ALLOC_GROW(addr, len, next) (syscall(SYS_mremap, (addr), (len), (next), 0) != -1)
+#define RBD_ALLOC_MOVE(addr, len, next, to) (syscall(SYS_mremap, (addr), (len), (next), MREMAP_MAYMOVE | MREMAP_FIXED, (to)) != -1)
+#else
+#define RBD_ALLOC_GROW(addr, len, next) false
+#define RBD_ALLOC_MOVE(addr, len, next, to) false
+#endif
+
+// RBD_ALLOC_GEN_DECL(Alloc)
+
+/* Generate the declarations for the allocator. */
+#define RBD_ALLOC_GEN_DECL(Alloc)\
+\
+  /*=================================================================================================================*/\
+  /* Allocator                                                                                                       */\
+  /*=================================================================================================================*/\
+\
+  /* Allocate an object of the provided size, 16-byte aligned. */\
+  void *RBD(Alloc, _alloc)(size_t size);\
+\
+  /* Resize the object, keeping it in place if it stays within its size class. */\
+  void *RBD(Alloc, _realloc)(void *ptr, size_t size);\
+\
+  /* Free the object (null is ignored). */\
+  void RBD(Alloc, _free)(void *ptr);\
+\
+  /* Get the usable size of the object. */\
+  size_t RBD(Alloc, _size)(void *ptr);\
+\
+  /* Print the underlying representation of the allocator with depth indentation. */\
+  void RBD(Alloc, _debug)(FILE *file, uint32_t depth);\
+\
+  /* Destruct the allocator, releasing every page at once. Large objects must be freed individually. */\
+  void RBD(Alloc, _des)();
+
+// RBD_ALLOC_GEN_DEF(Alloc, /*Allocator_alloc*/, /*Allocator_free*/)
+
+/* Generate the definitions for the allocator. Like the object pool it is a global that needs no construction. Pages */
+/* are carved from chunks of doubling size obtained from `Allocator_alloc`, and each page serves one size class from */
+/* its own free list and bump pointer. Pages left empty return to a shared list for any size class to reuse. Large */
+/* objects get their own mapping, trimmed so that it starts on a page boundary, and grow by remapping their pages */
+/* where the kernel allows; they bypass `Allocator_alloc` and `Allocator_free`, which only back the chunks. */
+/* `Alloc_alloc`, `Alloc_realloc` and `Alloc_free` plug into the allocator hooks of the other generators. */
+#define RBD_ALLOC_GEN_DEF(Alloc, Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Allocator Free Node                                                                                             */\
+  /*=================================================================================================================*/\
+\
+  /* Allocator free node. */\
+  typedef struct RBD(Alloc, Free) RBD(Alloc, Free);\
+\
+  /* Allocator free node. */\
+  struct RBD(Alloc, Free) {\
+    RBD(Alloc, Free) *next;\
+  };\
+\
+  /*=================================================================================================================*/\
+  /* Allocator Chunk Node                                                                                            */\
+  /*=================================================================================================================*/\
+\
+  /* Allocator chunk node, at the start of each allocation holding pages. */\
+  typedef struct RBD(Alloc, Chunk) RBD(Alloc, Chunk);\
+\
+  /* Allocator chunk node. */\
+  struct RBD(Alloc, Chunk) {\
+    RBD(Alloc, Chunk) *next;\
+    size_t pages;\
+  };\
+\
+  /*=================================================================================================================*/\
+  /* Allocator Page                                                                                                  */\
+  /*=================================================================================================================*/\
+\
+  /* Allocator page header. */\
+  typedef struct RBD(Alloc, Page) RBD(Alloc, Page);\
+\
+  /* Pages with free objects are linked into the list of their size class. A large page keeps its mapped length. */\
+  struct RBD(Alloc, Page) {\
+    RBD(Alloc, Page) *prev;\
+    RBD(Alloc, Page) *next;\
+    RBD(Alloc, Free) *frees;\
+    char *bump;\
+    size_t len;\
+    size_t size;\
+    uint32_t cls;\
+    uint32_t used;\
+    uint32_t cap;\
+    bool listed;\
+  };\
+\
+  /* Get the page holding the object. */\
+  RBD(Alloc, Page) *RBD(Alloc, Page_of)(void *ptr) {\
+    return (RBD(Alloc, Page) *)((uintptr_t)ptr & ~(uintptr_t)(RBD_ALLOC_PAGE_SIZE - 1));\
+  }\
+\
+  /* Construct a page serving the size class. */\
+  RBD(Alloc, Page) *RBD(Alloc, Page_cons)(RBD(Alloc, Page) *page, uint32_t cls, size_t size) {\
+    *page = (RBD(Alloc, Page)) {\
+      .bump = (char *)page + RBD_ALLOC_HEADER_SIZE,\
+      .size = size,\
+      .cls = cls,\
+      .cap = (uint32_t)((RBD_ALLOC_PAGE_SIZE - RBD_ALLOC_HEADER_SIZE) / size),\
+    };\
+    return page;\
+  }\
+\
+  /* Print the underlying representation of the page with depth indentation. */\
+  void RBD(Alloc, Page_debug)(RBD(Alloc, Page) *page, FILE *file, RBD_UNUSED uint32_t depth) {\
+    fprintf(file, #Alloc "Page (%p) { size: %lu, used: %u, cap: %u }", page, page->size, page->used, page->cap);\
+  }\
+\
+  /*=================================================================================================================*/\
+  /* Allocator                                                                                                       */\
+  /*=================================================================================================================*/\
+\
+  struct {\
+    RBD(Alloc, Page) *classes[RBD_ALLOC_CLASSES];\
+    RBD(Alloc, Page) *pages;\
+    RBD(Alloc, Chunk) *chunks;\
+    size_t chunkPages;\
+  } Alloc;\
+\
+  /* Get the size class of the size. */\
+  uint32_t RBD(Alloc, _class)(size_t size) {\
+    if (size <= 128) {\
+      return size ? (uint32_t)((size - 1) / 16) : 0;\
+    }\
+    uint32_t lg = 63 - __builtin_clzll(size - 1);\
+    return 8 + (lg - 7) * 4 + (uint32_t)((size - 1 - ((size_t)1 << lg)) >> (lg - 2));\
+  }\
+\
+  /* Get the object size of the size class. */\
+  size_t RBD(Alloc, _classSize)(uint32_t cls) {\
+    if (cls < 8) {\
+      return (size_t)(cls + 1) * 16;\
+    }\
+    uint32_t lg = 7 + (cls - 8) / 4;\
+    return ((size_t)1 << lg) + (size_t)((cls - 8) % 4 + 1) * ((size_t)1 << (lg - 2));\
+  }\
+\
+  /* Take an empty page, carving a new chunk of pages if none are left. */\
+  RBD(Alloc, Page) *RBD(Alloc, _page)() {\
+    if (!Alloc.pages) {\
+      Alloc.chunkPages = Alloc.chunkPages ? Alloc.chunkPages * 2 : 4;\
+      RBD(Alloc, Chunk) *chunk = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)((Alloc.chunkPages + 1) * RBD_ALLOC_PAGE_SIZE + sizeof(RBD(Alloc, Chunk)));\
+      *chunk = (RBD(Alloc, Chunk)) {\
+        .next = Alloc.chunks,\
+        .pages = Alloc.chunkPages,\
+      };\
+      Alloc.chunks = chunk;\
+      char *pages = (char *)RBD(Alloc, Page_of)((char *)(chunk + 1) + RBD_ALLOC_PAGE_SIZE - 1);\
+      for (size_t i = Alloc.chunkPages; i-- > 0;) {\
+        RBD(Alloc, Page) *page = (RBD(Alloc, Page) *)(pages + i * RBD_ALLOC_PAGE_SIZE);\
+        page->next = Alloc.pages;\
+        Alloc.pages = page;\
+      }\
+    }\
+    RBD(Alloc, Page) *page = Alloc.pages;\
+    Alloc.pages = page->next;\
+    return page;\
+  }\
+\
+  /* Link the page at the front of its size class list. */\
+  void RBD(Alloc, _link)(RBD(Alloc, Page) *page) {\
+    RBD(Alloc, Page) **head = &Alloc.classes[page->cls];\
+    page->prev = NULL;\
+    page->next = *head;\
+    if (*head) {\
+      (*head)->prev = page;\
+    }\
+    *head = page;\
+    page->listed = true;\
+  }\
+\
+  /* Unlink the page from its size class list. */\
+  void RBD(Alloc, _unlink)(RBD(Alloc, Page) *page) {\
+    if (page->prev) {\
+      page->prev->next = page->next;\
+    } else {\
+      Alloc.classes[page->cls] = page->next;\
+    }\
+    if (page->next) {\
+      page->next->prev = page->prev;\
+    }\
+    page->listed = false;\
+  }\
+\
+  /* Get the mapped length of a large page holding an object of the size, rounded up to whole system pages. */\
+  size_t RBD(Alloc, _largeLen)(size_t size) {\
+    size_t sys = (size_t)sysconf(_SC_PAGESIZE);\
+    return (size + RBD_ALLOC_HEADER_SIZE + sys - 1) & ~(sys - 1);\
+  }\
+\
+  /* Map the length at a page boundary, over-mapping by one page and unmapping the unaligned ends. */\
+  char *RBD(Alloc, _map)(size_t len) {\
+    char *mem = mmap(NULL, len + RBD_ALLOC_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);\
+    if (mem == MAP_FAILED) {\
+      return NULL;\
+    }\
+    char *start = (char *)RBD(Alloc, Page_of)(mem + RBD_ALLOC_PAGE_SIZE - 1);\
+    if (start > mem) {\
+      munmap(mem, start - mem);\
+    }\
+    munmap(start + len, mem + RBD_ALLOC_PAGE_SIZE - start);\
+    return start;\
+  }\
+\
+  /* Map a large page for an object of the size. */\
+  void *RBD(Alloc, _allocLarge)(size_t size) {\
+    size_t len = RBD(Alloc, _largeLen)(size);\
+    RBD(Alloc, Page) *page = (RBD(Alloc, Page) *)RBD(Alloc, _map)(len);\
+    if (!page) {\
+      return NULL;\
+    }\
+    *page = (RBD(Alloc, Page)) {\
+      .len = len,\
+      .size = size,\
+      .cls = RBD_ALLOC_LARGE,\
+      .used = 1,\
+      .cap = 1,\
+    };\
+    return (char *)page + RBD_ALLOC_HEADER_SIZE;\
+  }\
+\
+  /* Resize a large object, unmapping its tail to shrink. To grow, its pages are remapped in place or else moved to */\
+  /* a fresh aligned mapping, copying only where the kernel cannot move them. Returns null if mapping fails. */\
+  void *RBD(Alloc, _reallocLarge)(RBD(Alloc, Page) *page, size_t size) {\
+    size_t len = RBD(Alloc, _largeLen)(size);\
+    if (len < page->len) {\
+      munmap((char *)page + len, page->len - len);\
+    } else if (len > page->len && !RBD_ALLOC_GROW(page, page->len, len)) {\
+      char *start = RBD(Alloc, _map)(len);\
+      if (!start) {\
+        return NULL;\
+      }\
+      if (!RBD_ALLOC_MOVE(page, page->len, len, start)) {\
+        memcpy(start, page, page->len);\
+        munmap(page, page->len);\
+      }\
+      page = (RBD(Alloc, Page) *)start;\
+    }\
+    page->len = len;\
+    page->size = size;\
+    return (char *)page + RBD_ALLOC_HEADER_SIZE;\
+  }\
+\
+  void *RBD(Alloc, _alloc)(size_t size) {\
+    if (size > RBD_ALLOC_MAX_SIZE) {\
+      return RBD(Alloc, _allocLarge)(size);\
+    }\
+    uint32_t cls = RBD(Alloc, _class)(size);\
+    RBD(Alloc, Page) *page = Alloc.classes[cls];\
+    if (!page) {\
+      page = RBD(Alloc, Page_cons)(RBD(Alloc, _page)(), cls, RBD(Alloc, _classSize)(cls));\
+      RBD(Alloc, _link)(page);\
+    }\
+    void *ptr;\
+    if (page->frees) {\
+      ptr = page->frees;\
+      page->frees = page->frees->next;\
+    } else {\
+      ptr = page->bump;\
+      page->bump += page->size;\
+    }\
+    if (++page->used == page->cap) {\
+      RBD(Alloc, _unlink)(page);\
+    }\
+    return ptr;\
+  }\
+\
+  void RBD(Alloc, _free)(void *ptr) {\
+    if (!ptr) {\
+      return;\
+    }\
+    RBD(Alloc, Page) *page = RBD(Alloc, Page_of)(ptr);\
+    if (page->cls == RBD_ALLOC_LARGE) {\
+      munmap(page, page->len);\
+      return;\
+    }\
+    RBD(Alloc, Free) *node = ptr;\
+    node->next = page->frees;\
+    page->frees = node;\
+    page->used--;\
+    if (!page->listed) {\
+      RBD(Alloc, _link)(page);\
+    } else if (!page->used && (page->prev || page->next)) {\
+      RBD(Alloc, _unlink)(page);\
+      page->next = Alloc.pages;\
+      Alloc.pages = page;\
+    }\
+  }\
+\
+  size_t RBD(Alloc, _size)(void *ptr) {\
+    return RBD(Alloc, Page_of)(ptr)->size;\
+  }\
+\
+  void *RBD(Alloc, _realloc)(void *ptr, size_t size) {\
+    if (!ptr) {\
+      return RBD(Alloc, _alloc)(size);\
+    }\
+    RBD(Alloc, Page) *page = RBD(Alloc, Page_of)(ptr);\
+    if (page->cls != RBD_ALLOC_LARGE && size <= RBD_ALLOC_MAX_SIZE && RBD(Alloc, _class)(size) == page->cls) {\
+      return ptr;\
+    }\
+    if (page->cls == RBD_ALLOC_LARGE && size > RBD_ALLOC_MAX_SIZE) {\
+      return RBD(Alloc, _reallocLarge)(page, size);\
+    }\
+    void *next = RBD(Alloc, _alloc)(size);\
+    memcpy(next, ptr, size < page->size ? size : page->size);\
+    RBD(Alloc, _free)(ptr);\
+    return next;\
+  }\
+\
+  void RBD(Alloc, _debug)(FILE *file, uint32_t depth) {\
+    fprintf(file, #Alloc " (%p) {\n", (void *)&Alloc);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "classes: [\n");\
+    for (uint32_t cls = 0; cls < RBD_ALLOC_CLASSES; cls++) {\
+      RBD_INDENT(file, depth + 2); fprintf(file, "%lu: [", RBD(Alloc, _classSize)(cls));\
+      for (RBD(Alloc, Page) *page = Alloc.classes[cls]; page; page = page->next) {\
+        fprintf(file, "\n"); RBD_INDENT(file, depth + 3); RBD(Alloc, Page_debug)(page, file, depth + 3); fprintf(file, ",");\
+      }\
+      fprintf(file, Alloc.classes[cls] ? "\n" : "");\
+      if (Alloc.classes[cls]) {\
+        RBD_INDENT(file, depth + 2);\
+      }\
+      fprintf(file, "],\n");\
+    }\
+    RBD_INDENT(file, depth + 1); fprintf(file, "],\n");\
+    size_t pages = 0;\
+    for (RBD(Alloc, Page) *page = Alloc.pages; page; page = page->next) {\
+      pages++;\
+    }\
+    RBD_INDENT(file, depth + 1); fprintf(file, "pages: %lu,\n", pages);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "chunks: [\n");\
+    for (RBD(Alloc, Chunk) *chunk = Alloc.chunks; chunk; chunk = chunk->next) {\
+      RBD_INDENT(file, depth + 2); fprintf(file, #Alloc "Chunk (%p) { pages: %lu },\n", chunk, chunk->pages);\
+    }\
+    RBD_INDENT(file, depth + 1); fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "chunkPages: %lu,\n", Alloc.chunkPages);\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  void RBD(Alloc, _des)() {\
+    RBD(Alloc, Chunk) *curr = Alloc.chunks, *next;\
+    while (curr) {\
+      next = curr->next;\
+      RBD_IF(Allocator_free)(Allocator_free, free)(curr);\
+      curr = next;\
+    }\
+    memset(&Alloc, 0, sizeof(Alloc));\
+  }
+
+#endif // RBD_ALLOC_H
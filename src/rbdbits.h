@@ -0,0 +1,502 @@
+// vim: ft=c
+
+#ifndef RBD_BITS_H
+#define RBD_BITS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rbddef.h"
+
+/* Number of words needed to hold the bits. */
+#define RBD_BITS_WORDS(n) (((n) + 63) / 64)
+
+/* Number of set bits between select samples of the rank index. */
+#define RBD_BITS_SAMPLE 4096
+
+// RBD_BITS_GEN_DECL(Bits)
+
+/* Generate the declarations for the bitset. */
+#define RBD_BITS_GEN_DECL(Bits)\
+\
+  /*=================================================================================================================*/\
+  /* Bitset Iterator                                                                                                 */\
+  /*=================================================================================================================*/\
+\
+  /* Bitset iterator over set bits. */\
+  typedef struct RBD(Bits, Iter) RBD(Bits, Iter);\
+\
+  /* Bitset. */\
+  typedef struct Bits Bits;\
+\
+  /* Construct a new bitset iterator at the first set bit at or after i. */\
+  RBD(Bits, Iter) RBD(Bits, Iter_cons)(Bits *bits, size_t i);\
+\
+  /* Advance the bitset iterator to the next set bit. */\
+  RBD(Bits, Iter) RBD(Bits, Iter_next)(RBD(Bits, Iter) iter);\
+\
+  /* Get the index of the set bit at the current position. */\
+  size_t RBD(Bits, Iter_index)(RBD(Bits, Iter) iter);\
+\
+  /* Check if two iterators point to the same bit. */\
+  bool RBD(Bits, Iter_equals)(RBD(Bits, Iter) a, RBD(Bits, Iter) b);\
+\
+  /* Print the underlying representation of the iterator with depth indentation. */\
+  void RBD(Bits, Iter_debug)(RBD(Bits, Iter) iter, FILE *file, uint32_t depth);\
+\
+  /* Destruct the bitset iterator. */\
+  RBD(Bits, Iter) RBD(Bits, Iter_des)(RBD(Bits, Iter) iter);\
+\
+  /*=================================================================================================================*/\
+  /* Bitset                                                                                                          */\
+  /*=================================================================================================================*/\
+\
+  /* Construct a new bitset with initial capacity in bits. */\
+  Bits *RBD(Bits, _cons)(Bits *bits, size_t cap);\
+\
+  /* Get the capacity of the bitset in bits. */\
+  size_t RBD(Bits, _cap)(Bits *bits);\
+\
+  /* Get the length of the bitset in bits. */\
+  size_t RBD(Bits, _len)(Bits *bits);\
+\
+  /* Check if the bitset is empty. */\
+  bool RBD(Bits, _empty)(Bits *bits);\
+\
+  /* Get the words of the bitset, least significant bit first; bits past the length are zero. Drops the rank index, */\
+  /* since the words may be written through. */\
+  uint64_t *RBD(Bits, _words)(Bits *bits);\
+\
+  /* Reserve at least the provided capacity in bits. */\
+  void RBD(Bits, _reserve)(Bits *bits, size_t cap);\
+\
+  /* Resize to the provided length in bits, clearing any new bits. */\
+  void RBD(Bits, _resize)(Bits *bits, size_t len);\
+\
+  /* Clear all bits and set length to zero. */\
+  void RBD(Bits, _clear)(Bits *bits);\
+\
+  /* Push a bit onto the back. */\
+  void RBD(Bits, _pushBack)(Bits *bits, bool bit);\
+\
+  /* Pop a bit from the back. */\
+  bool RBD(Bits, _popBack)(Bits *bits);\
+\
+  /* Check if the bit at i is set. */\
+  bool RBD(Bits, _test)(Bits *bits, size_t i);\
+\
+  /* Set the bit at i. */\
+  void RBD(Bits, _set)(Bits *bits, size_t i);\
+\
+  /* Reset the bit at i. */\
+  void RBD(Bits, _reset)(Bits *bits, size_t i);\
+\
+  /* Flip the bit at i. */\
+  void RBD(Bits, _flip)(Bits *bits, size_t i);\
+\
+  /* Set the bit at i to the provided value. */\
+  void RBD(Bits, _assign)(Bits *bits, size_t i, bool bit);\
+\
+  /* Set every bit to the provided value. */\
+  void RBD(Bits, _fill)(Bits *bits, bool bit);\
+\
+  /* Get the number of set bits. */\
+  size_t RBD(Bits, _count)(Bits *bits);\
+\
+  /* Build the rank index, which every modification drops. While it is kept `rank` takes constant time and `select` */\
+  /* a binary search between samples; otherwise both scan the words. */\
+  void RBD(Bits, _index)(Bits *bits);\
+\
+  /* Get the number of set bits before i. */\
+  size_t RBD(Bits, _rank)(Bits *bits, size_t i);\
+\
+  /* Get the index of the set bit with the provided rank, or the length if there are not that many. */\
+  size_t RBD(Bits, _select)(Bits *bits, size_t rank);\
+\
+  /* Get the index of the first set bit at or after i, or the length if there is none. */\
+  size_t RBD(Bits, _next)(Bits *bits, size_t i);\
+\
+  /* Check if any bit is set. */\
+  bool RBD(Bits, _any)(Bits *bits);\
+\
+  /* Intersect the bitset with the other (must have the same length). */\
+  void RBD(Bits, _and)(Bits *bits, Bits *other);\
+\
+  /* Unite the bitset with the other (must have the same length). */\
+  void RBD(Bits, _or)(Bits *bits, Bits *other);\
+\
+  /* Take the symmetric difference of the bitset and the other (must have the same length). */\
+  void RBD(Bits, _xor)(Bits *bits, Bits *other);\
+\
+  /* Clear the bits of the bitset that are set in the other (must have the same length). */\
+  void RBD(Bits, _andNot)(Bits *bits, Bits *other);\
+\
+  /* Return iterator at the first set bit. */\
+  RBD(Bits, Iter) RBD(Bits, _begin)(Bits *bits);\
+\
+  /* Return iterator past the last bit. */\
+  RBD(Bits, Iter) RBD(Bits, _end)(Bits *bits);\
+\
+  /* Check if two bitsets are equal. */\
+  bool RBD(Bits, _equals)(Bits *a, Bits *b);\
+\
+  /* Print the underlying representation of the bitset. */\
+  void RBD(Bits, _debug)(Bits *bits, FILE *file, uint32_t depth);\
+\
+  /* Destruct the bitset. */\
+  Bits *RBD(Bits, _des)(Bits *bits);
+
+// RBD_BITS_GEN_DEF(Bits, /*Allocator_alloc*/, /*Allocator_realloc*/, /*Allocator_free*/)
+
+/* Generate the definitions for the bitset, packed into 64-bit words. Bulk operations run word by word in loops the */
+/* compiler vectorizes, and bits past the length are kept zero so that counts and comparisons need no masking. */
+#define RBD_BITS_GEN_DEF(Bits, Allocator_alloc, Allocator_realloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Bitset Iterator                                                                                                 */\
+  /*=================================================================================================================*/\
+\
+  struct RBD(Bits, Iter) {\
+    Bits *bits;\
+    size_t i;\
+  };\
+\
+  RBD(Bits, Iter) RBD(Bits, Iter_cons)(Bits *bits, size_t i) {\
+    return (RBD(Bits, Iter)) {\
+      .bits = bits,\
+      .i = RBD(Bits, _next)(bits, i),\
+    };\
+  }\
+\
+  RBD(Bits, Iter) RBD(Bits, Iter_next)(RBD(Bits, Iter) iter) {\
+    iter.i = RBD(Bits, _next)(iter.bits, iter.i + 1);\
+    return iter;\
+  }\
+\
+  size_t RBD(Bits, Iter_index)(RBD(Bits, Iter) iter) {\
+    return iter.i;\
+  }\
+\
+  bool RBD(Bits, Iter_equals)(RBD(Bits, Iter) a, RBD(Bits, Iter) b) {\
+    return (a.bits == b.bits && a.i == b.i);\
+  }\
+\
+  void RBD(Bits, Iter_debug)(RBD(Bits, Iter) iter, FILE *file, RBD_UNUSED uint32_t depth) {\
+    fprintf(file, #Bits "Iter { bits: %p, i: %lu }", iter.bits, iter.i);\
+  }\
+\
+  RBD(Bits, Iter) RBD(Bits, Iter_des)(RBD(Bits, Iter) iter) {\
+    return iter;\
+  }\
+\
+  /*=================================================================================================================*/\
+  /* Bitset                                                                                                          */\
+  /*=================================================================================================================*/\
+\
+  /* Capacity is kept a multiple of 64 bits. While indexed, ranks holds two words per 512-bit superblock: the set */\
+  /* bits before it, and the set bits before each of its words but the first in 9-bit fields. Samples holds the */\
+  /* superblock of every `RBD_BITS_SAMPLE`th set bit, then the last superblock. */\
+  struct Bits {\
+    uint64_t *words;\
+    size_t cap;\
+    size_t len;\
+    uint64_t *ranks;\
+    size_t *samples;\
+    bool indexed;\
+  };\
+\
+  Bits *RBD(Bits, _cons)(Bits *bits, size_t cap) {\
+    *bits = (Bits) {\
+      .words = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(RBD_BITS_WORDS(cap) * sizeof(uint64_t)),\
+      .cap = RBD_BITS_WORDS(cap) * 64,\
+      .len = 0,\
+      .ranks = NULL,\
+      .samples = NULL,\
+      .indexed = false,\
+    };\
+    return bits;\
+  }\
+\
+  size_t RBD(Bits, _cap)(Bits *bits) {\
+    return bits->cap;\
+  }\
+\
+  size_t RBD(Bits, _len)(Bits *bits) {\
+    return bits->len;\
+  }\
+\
+  bool RBD(Bits, _empty)(Bits *bits) {\
+    return !bits->len;\
+  }\
+\
+  uint64_t *RBD(Bits, _words)(Bits *bits) {\
+    bits->indexed = false;\
+    return bits->words;\
+  }\
+\
+  /* Reserve at least the provided capacity in bits, assuming capacity is larger than current. */\
+  void RBD(Bits, _reserveUnchecked)(Bits *bits, size_t cap) {\
+    bits->words = RBD_IF(Allocator_realloc)(Allocator_realloc, realloc)(bits->words, RBD_BITS_WORDS(cap) * sizeof(uint64_t));\
+    bits->cap = RBD_BITS_WORDS(cap) * 64;\
+  }\
+\
+  void RBD(Bits, _reserve)(Bits *bits, size_t cap) {\
+    if (cap > bits->cap) {\
+      RBD(Bits, _reserveUnchecked)(bits, cap);\
+    }\
+  }\
+\
+  void RBD(Bits, _resize)(Bits *bits, size_t len) {\
+    bits->indexed = false;\
+    if (len > bits->cap) {\
+      RBD(Bits, _reserveUnchecked)(bits, len);\
+    }\
+    if (len > bits->len) {\
+      size_t from = RBD_BITS_WORDS(bits->len), to = RBD_BITS_WORDS(len);\
+      memset(&bits->words[from], 0, (to - from) * sizeof(uint64_t));\
+    } else if (len % 64) {\
+      bits->words[len / 64] &= ((uint64_t)1 << (len % 64)) - 1;\
+    }\
+    bits->len = len;\
+  }\
+\
+  void RBD(Bits, _clear)(Bits *bits) {\
+    bits->indexed = false;\
+    bits->len = 0;\
+  }\
+\
+  void RBD(Bits, _pushBack)(Bits *bits, bool bit) {\
+    bits->indexed = false;\
+    if (bits->len == bits->cap) {\
+      RBD(Bits, _reserveUnchecked)(bits, bits->cap ? bits->cap * 2 : 64);\
+    }\
+    if (!(bits->len % 64)) {\
+      bits->words[bits->len / 64] = 0;\
+    }\
+    bits->words[bits->len / 64] |= (uint64_t)bit << (bits->len % 64);\
+    bits->len++;\
+  }\
+\
+  bool RBD(Bits, _popBack)(Bits *bits) {\
+    bits->indexed = false;\
+    bits->len--;\
+    uint64_t mask = (uint64_t)1 << (bits->len % 64);\
+    bool bit = bits->words[bits->len / 64] & mask;\
+    bits->words[bits->len / 64] &= ~mask;\
+    return bit;\
+  }\
+\
+  bool RBD(Bits, _test)(Bits *bits, size_t i) {\
+    return (bits->words[i / 64] >> (i % 64)) & 1;\
+  }\
+\
+  void RBD(Bits, _set)(Bits *bits, size_t i) {\
+    bits->indexed = false;\
+    bits->words[i / 64] |= (uint64_t)1 << (i % 64);\
+  }\
+\
+  void RBD(Bits, _reset)(Bits *bits, size_t i) {\
+    bits->indexed = false;\
+    bits->words[i / 64] &= ~((uint64_t)1 << (i % 64));\
+  }\
+\
+  void RBD(Bits, _flip)(Bits *bits, size_t i) {\
+    bits->indexed = false;\
+    bits->words[i / 64] ^= (uint64_t)1 << (i % 64);\
+  }\
+\
+  void RBD(Bits, _assign)(Bits *bits, size_t i, bool bit) {\
+    bits->indexed = false;\
+    bits->words[i / 64] = (bits->words[i / 64] & ~((uint64_t)1 << (i % 64))) | ((uint64_t)bit << (i % 64));\
+  }\
+\
+  void RBD(Bits, _fill)(Bits *bits, bool bit) {\
+    bits->indexed = false;\
+    memset(bits->words, bit ? 0xff : 0, RBD_BITS_WORDS(bits->len) * sizeof(uint64_t));\
+    if (bit && bits->len % 64) {\
+      bits->words[bits->len / 64] = ((uint64_t)1 << (bits->len % 64)) - 1;\
+    }\
+  }\
+\
+  size_t RBD(Bits, _count)(Bits *bits) {\
+    size_t n = 0;\
+    for (size_t w = 0, words = RBD_BITS_WORDS(bits->len); w < words; w++) {\
+      n += __builtin_popcountll(bits->words[w]);\
+    }\
+    return n;\
+  }\
+\
+  void RBD(Bits, _index)(Bits *bits) {\
+    size_t words = RBD_BITS_WORDS(bits->len), supers = words / 8 + 1;\
+    bits->ranks = RBD_IF(Allocator_realloc)(Allocator_realloc, realloc)(bits->ranks, 2 * supers * sizeof(uint64_t));\
+    uint64_t n = 0;\
+    for (size_t s = 0; s < supers; s++) {\
+      uint64_t before = 0, counts = 0;\
+      for (size_t k = 0; k < 8; k++) {\
+        if (k) {\
+          counts |= before << (9 * (k - 1));\
+        }\
+        if (8 * s + k < words) {\
+          before += __builtin_popcountll(bits->words[8 * s + k]);\
+        }\
+      }\
+      bits->ranks[2 * s] = n;\
+      bits->ranks[2 * s + 1] = counts;\
+      n += before;\
+    }\
+    bits->samples = RBD_IF(Allocator_realloc)(Allocator_realloc, realloc)(bits->samples, ((n + RBD_BITS_SAMPLE - 1) / RBD_BITS_SAMPLE + 1) * sizeof(size_t));\
+    size_t j = 0;\
+    for (size_t s = 0; s < supers; s++) {\
+      uint64_t end = s + 1 < supers ? bits->ranks[2 * (s + 1)] : n;\
+      for (; j * RBD_BITS_SAMPLE < end; j++) {\
+        bits->samples[j] = s;\
+      }\
+    }\
+    bits->samples[j] = supers - 1;\
+    bits->indexed = true;\
+  }\
+\
+  size_t RBD(Bits, _rank)(Bits *bits, size_t i) {\
+    size_t n = 0;\
+    if (bits->indexed) {\
+      size_t s = i / 512, k = i / 64 % 8;\
+      n = bits->ranks[2 * s] + (k ? (bits->ranks[2 * s + 1] >> (9 * (k - 1))) & 0x1ff : 0);\
+    } else {\
+      for (size_t w = 0; w < i / 64; w++) {\
+        n += __builtin_popcountll(bits->words[w]);\
+      }\
+    }\
+    if (i % 64) {\
+      n += __builtin_popcountll(bits->words[i / 64] & (((uint64_t)1 << (i % 64)) - 1));\
+    }\
+    return n;\
+  }\
+\
+  /* Get the index of the set bit with the provided rank within the word. */\
+  size_t RBD(Bits, _selectWord)(uint64_t word, size_t rank) {\
+    for (; rank > 0; rank--) {\
+      word &= word - 1;\
+    }\
+    return __builtin_ctzll(word);\
+  }\
+\
+  size_t RBD(Bits, _select)(Bits *bits, size_t rank) {\
+    if (bits->indexed) {\
+      if (rank >= RBD(Bits, _rank)(bits, bits->len)) {\
+        return bits->len;\
+      }\
+      size_t lo = bits->samples[rank / RBD_BITS_SAMPLE], hi = bits->samples[rank / RBD_BITS_SAMPLE + 1];\
+      while (lo < hi) {\
+        size_t mid = (lo + hi + 1) / 2;\
+        if (bits->ranks[2 * mid] <= rank) {\
+          lo = mid;\
+        } else {\
+          hi = mid - 1;\
+        }\
+      }\
+      uint64_t counts = bits->ranks[2 * lo + 1], before = 0;\
+      size_t k = 0;\
+      for (rank -= bits->ranks[2 * lo]; k < 7 && ((counts >> (9 * k)) & 0x1ff) <= rank; k++) {\
+        before = (counts >> (9 * k)) & 0x1ff;\
+      }\
+      return (8 * lo + k) * 64 + RBD(Bits, _selectWord)(bits->words[8 * lo + k], rank - before);\
+    }\
+    for (size_t w = 0, words = RBD_BITS_WORDS(bits->len); w < words; w++) {\
+      uint64_t word = bits->words[w];\
+      size_t n = __builtin_popcountll(word);\
+      if (rank < n) {\
+        return w * 64 + RBD(Bits, _selectWord)(word, rank);\
+      }\
+      rank -= n;\
+    }\
+    return bits->len;\
+  }\
+\
+  size_t RBD(Bits, _next)(Bits *bits, size_t i) {\
+    if (i >= bits->len) {\
+      return bits->len;\
+    }\
+    size_t w = i / 64, words = RBD_BITS_WORDS(bits->len);\
+    uint64_t word = bits->words[w] & (~(uint64_t)0 << (i % 64));\
+    while (!word) {\
+      if (++w == words) {\
+        return bits->len;\
+      }\
+      word = bits->words[w];\
+    }\
+    return w * 64 + __builtin_ctzll(word);\
+  }\
+\
+  bool RBD(Bits, _any)(Bits *bits) {\
+    uint64_t any = 0;\
+    for (size_t w = 0, words = RBD_BITS_WORDS(bits->len); w < words; w++) {\
+      any |= bits->words[w];\
+    }\
+    return any != 0;\
+  }\
+\
+  void RBD(Bits, _and)(Bits *bits, Bits *other) {\
+    bits->indexed = false;\
+    for (size_t w = 0, words = RBD_BITS_WORDS(bits->len); w < words; w++) {\
+      bits->words[w] &= other->words[w];\
+    }\
+  }\
+\
+  void RBD(Bits, _or)(Bits *bits, Bits *other) {\
+    bits->indexed = false;\
+    for (size_t w = 0, words = RBD_BITS_WORDS(bits->len); w < words; w++) {\
+      bits->words[w] |= other->words[w];\
+    }\
+  }\
+\
+  void RBD(Bits, _xor)(Bits *bits, Bits *other) {\
+    bits->indexed = false;\
+    for (size_t w = 0, words = RBD_BITS_WORDS(bits->len); w < words; w++) {\
+      bits->words[w] ^= other->words[w];\
+    }\
+  }\
+\
+  void RBD(Bits, _andNot)(Bits *bits, Bits *other) {\
+    bits->indexed = false;\
+    for (size_t w = 0, words = RBD_BITS_WORDS(bits->len); w < words; w++) {\
+      bits->words[w] &= ~other->words[w];\
+    }\
+  }\
+\
+  RBD(Bits, Iter) RBD(Bits, _begin)(Bits *bits) {\
+    return RBD(Bits, Iter_cons)(bits, 0);\
+  }\
+\
+  RBD(Bits, Iter) RBD(Bits, _end)(Bits *bits) {\
+    return RBD(Bits, Iter_cons)(bits, bits->len);\
+  }\
+\
+  bool RBD(Bits, _equals)(Bits *a, Bits *b) {\
+    return a->len == b->len && !memcmp(a->words, b->words, RBD_BITS_WORDS(a->len) * sizeof(uint64_t));\
+  }\
+\
+  void RBD(Bits, _debug)(Bits *bits, FILE *file, uint32_t depth) {\
+    fprintf(file, #Bits " (%p) {\n", bits);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "words: (%p) [", bits->words);\
+    for (size_t w = 0, words = RBD_BITS_WORDS(bits->len); w < words; w++) {\
+      fprintf(file, w ? ", %016lx" : "%016lx", bits->words[w]);\
+    }\
+    fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "cap: %lu,\n", bits->cap);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "len: %lu,\n", bits->len);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "indexed: %s,\n", bits->indexed ? "true" : "false");\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  Bits *RBD(Bits, _des)(Bits *bits) {\
+    RBD_IF(Allocator_free)(Allocator_free, free)(bits->words);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(bits->ranks);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(bits->samples);\
+    return bits;\
+  }
+
+#endif // RBD_BITS_H
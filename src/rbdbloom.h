@@ -0,0 +1,561 @@
+// vim: ft=c
+
+#ifndef RBD_BLOOM_H
+#define RBD_BLOOM_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rbddef.h"
+#include "rbdmap.h"
+
+/* Number of 64-bit words in a filter block, one cache line. Every key touches exactly one bit or counter per word. */
+#define RBD_BLOOM_BLOCK_WORDS 8
+
+/* Bits of a bloom filter per expected key (about 0.4% false positives with 512-bit blocks). */
+#define RBD_BLOOM_BITS_PER_KEY 12
+
+/* Bits of a counting bloom filter per expected key, four bits per counter (about 0.8% false positives). */
+#define RBD_COUNTINGBLOOM_BITS_PER_KEY 48
+
+/* Odd multipliers choosing the bit or counter of a key within each word of its block. */
+#define RBD_BLOOM_SALTS {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U}
+
+// RBD_BLOOM_GEN_DECL(Bloom, Key)
+
+/* Generate the declarations for the bloom filter. */
+#define RBD_BLOOM_GEN_DECL(Bloom, Key)\
+\
+  /*=================================================================================================================*/\
+  /* Bloom Filter Block                                                                                              */\
+  /*=================================================================================================================*/\
+\
+  /* Bloom filter block. */\
+  typedef struct RBD(Bloom, Block) RBD(Bloom, Block);\
+\
+  /*=================================================================================================================*/\
+  /* Bloom Filter                                                                                                    */\
+  /*=================================================================================================================*/\
+\
+  /* Bloom filter. */\
+  typedef struct Bloom Bloom;\
+\
+  /* Construct a new bloom filter sized for the provided number of keys. */\
+  Bloom *RBD(Bloom, _cons)(Bloom *bloom, size_t cap);\
+\
+  /* Check if the bloom filter is empty. */\
+  bool RBD(Bloom, _empty)(Bloom *bloom);\
+\
+  /* Get the number of keys the bloom filter was sized for. */\
+  size_t RBD(Bloom, _cap)(Bloom *bloom);\
+\
+  /* Get the number of keys inserted into the bloom filter (counting duplicates). */\
+  size_t RBD(Bloom, _len)(Bloom *bloom);\
+\
+  /* Insert the key into the bloom filter. */\
+  void RBD(Bloom, _insert)(Bloom *bloom, Key key);\
+\
+  /* Check if the key may exist in the bloom filter. False means it was never inserted. */\
+  bool RBD(Bloom, _contains)(Bloom *bloom, Key key);\
+\
+  /* Clear all keys and set length to zero. */\
+  void RBD(Bloom, _clear)(Bloom *bloom);\
+\
+  /* Print the underlying representation of the bloom filter. */\
+  void RBD(Bloom, _debug)(Bloom *bloom, FILE *file, uint32_t depth);\
+\
+  /* Destruct the bloom filter. */\
+  Bloom *RBD(Bloom, _des)(Bloom *bloom);
+
+// RBD_BLOOM_GEN_DEF(Bloom, Key, /*Key_hash*/, /*Allocator_alloc*/, /*Allocator_free*/)
+
+/* Generate the definitions for the bloom filter. The filter is blocked: a key selects one cache-line block and sets */
+/* one bit in each of its words, so an insert or lookup touches a single cache line and vectorizes. */
+#define RBD_BLOOM_GEN_DEF(Bloom, Key, Key_hash, Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Bloom Filter Block                                                                                              */\
+  /*=================================================================================================================*/\
+\
+  struct RBD(Bloom, Block) {\
+    uint64_t words[RBD_BLOOM_BLOCK_WORDS];\
+  };\
+\
+  /* Get the bit mask of each word of the block for the hash. */\
+  void RBD(Bloom, Block_masks)(uint64_t hash, uint64_t *masks) {\
+    static const uint32_t salts[RBD_BLOOM_BLOCK_WORDS] = RBD_BLOOM_SALTS;\
+    for (size_t w = 0; w < RBD_BLOOM_BLOCK_WORDS; w++) {\
+      masks[w] = (uint64_t)1 << (((uint32_t)hash * salts[w]) >> 26);\
+    }\
+  }\
+\
+  /*=================================================================================================================*/\
+  /* Bloom Filter                                                                                                    */\
+  /*=================================================================================================================*/\
+\
+  /* Blocks are aligned to a cache line within the allocation at mem. */\
+  struct Bloom {\
+    void *mem;\
+    RBD(Bloom, Block) *blocks;\
+    size_t nblocks;\
+    size_t cap;\
+    size_t len;\
+  };\
+\
+  Bloom *RBD(Bloom, _cons)(Bloom *bloom, size_t cap) {\
+    size_t nblocks = (cap * RBD_BLOOM_BITS_PER_KEY + 64 * RBD_BLOOM_BLOCK_WORDS - 1) / (64 * RBD_BLOOM_BLOCK_WORDS);\
+    nblocks = nblocks ? nblocks : 1;\
+    void *mem = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)((nblocks + 1) * sizeof(RBD(Bloom, Block)));\
+    *bloom = (Bloom) {\
+      .mem = mem,\
+      .blocks = (RBD(Bloom, Block) *)(((uintptr_t)mem + RBD_CACHE_LINE - 1) & ~(uintptr_t)(RBD_CACHE_LINE - 1)),\
+      .nblocks = nblocks,\
+      .cap = cap,\
+    };\
+    memset(bloom->blocks, 0, nblocks * sizeof(RBD(Bloom, Block)));\
+    return bloom;\
+  }\
+\
+  bool RBD(Bloom, _empty)(Bloom *bloom) {\
+    return !bloom->len;\
+  }\
+\
+  size_t RBD(Bloom, _cap)(Bloom *bloom) {\
+    return bloom->cap;\
+  }\
+\
+  size_t RBD(Bloom, _len)(Bloom *bloom) {\
+    return bloom->len;\
+  }\
+\
+  /* Hash the key. */\
+  uint64_t RBD(Bloom, _hash)(Key key) {\
+    return RBD_MIX((uint64_t)RBD_IF(Key_hash)(Key_hash(key), (size_t)key));\
+  }\
+\
+  void RBD(Bloom, _insert)(Bloom *bloom, Key key) {\
+    uint64_t hash = RBD(Bloom, _hash)(key);\
+    RBD(Bloom, Block) *block = &bloom->blocks[RBD_RANGE(hash, bloom->nblocks)];\
+    uint64_t masks[RBD_BLOOM_BLOCK_WORDS];\
+    RBD(Bloom, Block_masks)(hash, masks);\
+    for (size_t w = 0; w < RBD_BLOOM_BLOCK_WORDS; w++) {\
+      block->words[w] |= masks[w];\
+    }\
+    bloom->len++;\
+  }\
+\
+  bool RBD(Bloom, _contains)(Bloom *bloom, Key key) {\
+    uint64_t hash = RBD(Bloom, _hash)(key);\
+    RBD(Bloom, Block) *block = &bloom->blocks[RBD_RANGE(hash, bloom->nblocks)];\
+    uint64_t masks[RBD_BLOOM_BLOCK_WORDS];\
+    RBD(Bloom, Block_masks)(hash, masks);\
+    uint64_t missing = 0;\
+    for (size_t w = 0; w < RBD_BLOOM_BLOCK_WORDS; w++) {\
+      missing |= masks[w] & ~block->words[w];\
+    }\
+    return !missing;\
+  }\
+\
+  void RBD(Bloom, _clear)(Bloom *bloom) {\
+    memset(bloom->blocks, 0, bloom->nblocks * sizeof(RBD(Bloom, Block)));\
+    bloom->len = 0;\
+  }\
+\
+  void RBD(Bloom, _debug)(Bloom *bloom, FILE *file, uint32_t depth) {\
+    fprintf(file, #Bloom " (%p) {\n", bloom);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "blocks: (%p) [\n", bloom->blocks);\
+    for (size_t i = 0; i < bloom->nblocks; i++) {\
+      RBD_INDENT(file, depth + 2); fprintf(file, "[");\
+      for (size_t w = 0; w < RBD_BLOOM_BLOCK_WORDS; w++) {\
+        fprintf(file, w ? ", %016lx" : "%016lx", bloom->blocks[i].words[w]);\
+      }\
+      fprintf(file, "],\n");\
+    }\
+    RBD_INDENT(file, depth + 1); fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "nblocks: %lu,\n", bloom->nblocks);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "cap: %lu,\n", bloom->cap);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "len: %lu,\n", bloom->len);\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  Bloom *RBD(Bloom, _des)(Bloom *bloom) {\
+    RBD_IF(Allocator_free)(Allocator_free, free)(bloom->mem);\
+    return bloom;\
+  }
+
+// RBD_COUNTINGBLOOM_GEN_DECL(Bloom, Key)
+
+/* Generate the declarations for the counting bloom filter. */
+#define RBD_COUNTINGBLOOM_GEN_DECL(Bloom, Key)\
+\
+  /*=================================================================================================================*/\
+  /* Counting Bloom Filter Block                                                                                     */\
+  /*=================================================================================================================*/\
+\
+  /* Counting bloom filter block. */\
+  typedef struct RBD(Bloom, Block) RBD(Bloom, Block);\
+\
+  /*=================================================================================================================*/\
+  /* Counting Bloom Filter                                                                                           */\
+  /*=================================================================================================================*/\
+\
+  /* Counting bloom filter. */\
+  typedef struct Bloom Bloom;\
+\
+  /* Construct a new counting bloom filter sized for the provided number of keys. */\
+  Bloom *RBD(Bloom, _cons)(Bloom *bloom, size_t cap);\
+\
+  /* Check if the counting bloom filter is empty. */\
+  bool RBD(Bloom, _empty)(Bloom *bloom);\
+\
+  /* Get the number of keys the counting bloom filter was sized for. */\
+  size_t RBD(Bloom, _cap)(Bloom *bloom);\
+\
+  /* Get the number of keys in the counting bloom filter (counting duplicates). */\
+  size_t RBD(Bloom, _len)(Bloom *bloom);\
+\
+  /* Insert the key into the counting bloom filter. */\
+  void RBD(Bloom, _insert)(Bloom *bloom, Key key);\
+\
+  /* Check if the key may exist in the counting bloom filter. False means it is not present. */\
+  bool RBD(Bloom, _contains)(Bloom *bloom, Key key);\
+\
+  /* Erase the key from the counting bloom filter (must have been inserted). */\
+  void RBD(Bloom, _erase)(Bloom *bloom, Key key);\
+\
+  /* Clear all keys and set length to zero. */\
+  void RBD(Bloom, _clear)(Bloom *bloom);\
+\
+  /* Print the underlying representation of the counting bloom filter. */\
+  void RBD(Bloom, _debug)(Bloom *bloom, FILE *file, uint32_t depth);\
+\
+  /* Destruct the counting bloom filter. */\
+  Bloom *RBD(Bloom, _des)(Bloom *bloom);
+
+// RBD_COUNTINGBLOOM_GEN_DEF(Bloom, Key, /*Key_hash*/, /*Allocator_alloc*/, /*Allocator_free*/)
+
+/* Generate the definitions for the counting bloom filter. Blocks are laid out as in the bloom filter, but each word */
+/* holds sixteen 4-bit counters instead of 64 bits. A counter that reaches its maximum sticks there, so erasing never */
+/* introduces false negatives; it only stops reclaiming that counter. */
+#define RBD_COUNTINGBLOOM_GEN_DEF(Bloom, Key, Key_hash, Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Counting Bloom Filter Block                                                                                     */\
+  /*=================================================================================================================*/\
+\
+  struct RBD(Bloom, Block) {\
+    uint64_t words[RBD_BLOOM_BLOCK_WORDS];\
+  };\
+\
+  /* Get the counter shift of each word of the block for the hash. */\
+  void RBD(Bloom, Block_shifts)(uint64_t hash, uint32_t *shifts) {\
+    static const uint32_t salts[RBD_BLOOM_BLOCK_WORDS] = RBD_BLOOM_SALTS;\
+    for (size_t w = 0; w < RBD_BLOOM_BLOCK_WORDS; w++) {\
+      shifts[w] = (((uint32_t)hash * salts[w]) >> 28) * 4;\
+    }\
+  }\
+\
+  /*=================================================================================================================*/\
+  /* Counting Bloom Filter                                                                                           */\
+  /*=================================================================================================================*/\
+\
+  /* Blocks are aligned to a cache line within the allocation at mem. */\
+  struct Bloom {\
+    void *mem;\
+    RBD(Bloom, Block) *blocks;\
+    size_t nblocks;\
+    size_t cap;\
+    size_t len;\
+  };\
+\
+  Bloom *RBD(Bloom, _cons)(Bloom *bloom, size_t cap) {\
+    size_t nblocks = (cap * RBD_COUNTINGBLOOM_BITS_PER_KEY + 64 * RBD_BLOOM_BLOCK_WORDS - 1) / (64 * RBD_BLOOM_BLOCK_WORDS);\
+    nblocks = nblocks ? nblocks : 1;\
+    void *mem = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)((nblocks + 1) * sizeof(RBD(Bloom, Block)));\
+    *bloom = (Bloom) {\
+      .mem = mem,\
+      .blocks = (RBD(Bloom, Block) *)(((uintptr_t)mem + RBD_CACHE_LINE - 1) & ~(uintptr_t)(RBD_CACHE_LINE - 1)),\
+      .nblocks = nblocks,\
+      .cap = cap,\
+    };\
+    memset(bloom->blocks, 0, nblocks * sizeof(RBD(Bloom, Block)));\
+    return bloom;\
+  }\
+\
+  bool RBD(Bloom, _empty)(Bloom *bloom) {\
+    return !bloom->len;\
+  }\
+\
+  size_t RBD(Bloom, _cap)(Bloom *bloom) {\
+    return bloom->cap;\
+  }\
+\
+  size_t RBD(Bloom, _len)(Bloom *bloom) {\
+    return bloom->len;\
+  }\
+\
+  /* Hash the key. */\
+  uint64_t RBD(Bloom, _hash)(Key key) {\
+    return RBD_MIX((uint64_t)RBD_IF(Key_hash)(Key_hash(key), (size_t)key));\
+  }\
+\
+  void RBD(Bloom, _insert)(Bloom *bloom, Key key) {\
+    uint64_t hash = RBD(Bloom, _hash)(key);\
+    RBD(Bloom, Block) *block = &bloom->blocks[RBD_RANGE(hash, bloom->nblocks)];\
+    uint32_t shifts[RBD_BLOOM_BLOCK_WORDS];\
+    RBD(Bloom, Block_shifts)(hash, shifts);\
+    for (size_t w = 0; w < RBD_BLOOM_BLOCK_WORDS; w++) {\
+      uint64_t counter = (block->words[w] >> shifts[w]) & 0xf;\
+      block->words[w] += (uint64_t)(counter != 0xf) << shifts[w];\
+    }\
+    bloom->len++;\
+  }\
+\
+  bool RBD(Bloom, _contains)(Bloom *bloom, Key key) {\
+    uint64_t hash = RBD(Bloom, _hash)(key);\
+    RBD(Bloom, Block) *block = &bloom->blocks[RBD_RANGE(hash, bloom->nblocks)];\
+    uint32_t shifts[RBD_BLOOM_BLOCK_WORDS];\
+    RBD(Bloom, Block_shifts)(hash, shifts);\
+    bool present = true;\
+    for (size_t w = 0; w < RBD_BLOOM_BLOCK_WORDS; w++) {\
+      present &= ((block->words[w] >> shifts[w]) & 0xf) != 0;\
+    }\
+    return present;\
+  }\
+\
+  void RBD(Bloom, _erase)(Bloom *bloom, Key key) {\
+    uint64_t hash = RBD(Bloom, _hash)(key);\
+    RBD(Bloom, Block) *block = &bloom->blocks[RBD_RANGE(hash, bloom->nblocks)];\
+    uint32_t shifts[RBD_BLOOM_BLOCK_WORDS];\
+    RBD(Bloom, Block_shifts)(hash, shifts);\
+    for (size_t w = 0; w < RBD_BLOOM_BLOCK_WORDS; w++) {\
+      uint64_t counter = (block->words[w] >> shifts[w]) & 0xf;\
+      block->words[w] -= (uint64_t)(counter != 0xf && counter != 0) << shifts[w];\
+    }\
+    bloom->len--;\
+  }\
+\
+  void RBD(Bloom, _clear)(Bloom *bloom) {\
+    memset(bloom->blocks, 0, bloom->nblocks * sizeof(RBD(Bloom, Block)));\
+    bloom->len = 0;\
+  }\
+\
+  void RBD(Bloom, _debug)(Bloom *bloom, FILE *file, uint32_t depth) {\
+    fprintf(file, #Bloom " (%p) {\n", bloom);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "blocks: (%p) [\n", bloom->blocks);\
+    for (size_t i = 0; i < bloom->nblocks; i++) {\
+      RBD_INDENT(file, depth + 2); fprintf(file, "[");\
+      for (size_t w = 0; w < RBD_BLOOM_BLOCK_WORDS; w++) {\
+        fprintf(file, w ? ", %016lx" : "%016lx", bloom->blocks[i].words[w]);\
+      }\
+      fprintf(file, "],\n");\
+    }\
+    RBD_INDENT(file, depth + 1); fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "nblocks: %lu,\n", bloom->nblocks);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "cap: %lu,\n", bloom->cap);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "len: %lu,\n", bloom->len);\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  Bloom *RBD(Bloom, _des)(Bloom *bloom) {\
+    RBD_IF(Allocator_free)(Allocator_free, free)(bloom->mem);\
+    return bloom;\
+  }
+
+// RBD_BLOOMMAP_GEN_DECL(BloomMap, Key, Val)
+
+/* Generate the declarations for the bloom map. */
+#define RBD_BLOOMMAP_GEN_DECL(BloomMap, Key, Val)\
+\
+  /*=================================================================================================================*/\
+  /* Bloom Map Table                                                                                                 */\
+  /*=================================================================================================================*/\
+\
+  RBD_MAP_GEN_DECL(RBD(BloomMap, Map), Key, Val)\
+\
+  /*=================================================================================================================*/\
+  /* Bloom Map Filter                                                                                                */\
+  /*=================================================================================================================*/\
+\
+  RBD_COUNTINGBLOOM_GEN_DECL(RBD(BloomMap, Filter), Key)\
+\
+  /*=================================================================================================================*/\
+  /* Bloom Map                                                                                                       */\
+  /*=================================================================================================================*/\
+\
+  /* Bloom map. */\
+  typedef struct BloomMap BloomMap;\
+\
+  /* Construct a new bloom map with initial capacity. */\
+  BloomMap *RBD(BloomMap, _cons)(BloomMap *bmap, size_t cap);\
+\
+  /* Check if the bloom map is empty. */\
+  bool RBD(BloomMap, _empty)(BloomMap *bmap);\
+\
+  /* Get the length of the bloom map. */\
+  size_t RBD(BloomMap, _len)(BloomMap *bmap);\
+\
+  /* Insert a new element into the bloom map (must not exist). */\
+  void RBD(BloomMap, _insert)(BloomMap *bmap, Key key, Val val);\
+\
+  /* Same as `insert`, but returning a pointer to the element to-be-constructed. */\
+  Val *RBD(BloomMap, _emplace)(BloomMap *bmap, Key key);\
+\
+  /* Replace an existing element in the bloom map (must exist). */\
+  void RBD(BloomMap, _replace)(BloomMap *bmap, Key key, Val val);\
+\
+  /* Same as `replace`, but returning a pointer to the element to-be-constructed. */\
+  Val *RBD(BloomMap, _remplace)(BloomMap *bmap, Key key);\
+\
+  /* Get the value of the provided key (must exist). */\
+  Val *RBD(BloomMap, _at)(BloomMap *bmap, Key key);\
+\
+  /* Get the element of the provided key, skipping the table probe when the filter rules it out. */\
+  RBD(BloomMap, MapIter) RBD(BloomMap, _find)(BloomMap *bmap, Key key);\
+\
+  /* Check if the key exists in the bloom map, skipping the table probe when the filter rules it out. */\
+  bool RBD(BloomMap, _contains)(BloomMap *bmap, Key key);\
+\
+  /* Erase the provided element (must exist). */\
+  void RBD(BloomMap, _erase)(BloomMap *bmap, Key key);\
+\
+  /* Clear all elements and set length to zero, calling element destructor for each element. */\
+  void RBD(BloomMap, _clear)(BloomMap *bmap);\
+\
+  /* Return iterator starting at first element. */\
+  RBD(BloomMap, MapIter) RBD(BloomMap, _begin)(BloomMap *bmap);\
+\
+  /* Return iterator starting after last element. */\
+  RBD(BloomMap, MapIter) RBD(BloomMap, _end)(BloomMap *bmap);\
+\
+  /* Print the underlying representation of the bloom map, calling element debug for each element. */\
+  void RBD(BloomMap, _debug)(BloomMap *bmap, FILE *file, uint32_t depth);\
+\
+  /* Destruct the bloom map. */\
+  BloomMap *RBD(BloomMap, _des)(BloomMap *bmap);
+
+// RBD_BLOOMMAP_GEN_DEF(BloomMap, Key, /*Key_hash*/, /*Key_equals*/, /*Key_debug*/, /*Key_des*/, Val, /*&*/, /*Val_equals*/, /*Val_debug*/, /*Val_des*/, /*Allocator_alloc*/, /*Allocator_free*/)
+
+/* Generate the definitions for the bloom map, a map fronted by a counting bloom filter that is kept up to date on */
+/* every insertion and erasure. The filter is rebuilt at twice the length whenever the map outgrows it. */
+#define RBD_BLOOMMAP_GEN_DEF(BloomMap, Key, Key_hash, Key_equals, Key_debug, Key_des, Val, Val_ref, Val_equals, Val_debug, Val_des, Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Bloom Map Table                                                                                                 */\
+  /*=================================================================================================================*/\
+\
+  RBD_MAP_GEN_DEF(RBD(BloomMap, Map), Key, Key_hash, Key_equals, Key_debug, Key_des, Val, Val_ref, Val_equals, Val_debug, Val_des, Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Bloom Map Filter                                                                                                */\
+  /*=================================================================================================================*/\
+\
+  RBD_COUNTINGBLOOM_GEN_DEF(RBD(BloomMap, Filter), Key, Key_hash, Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Bloom Map                                                                                                       */\
+  /*=================================================================================================================*/\
+\
+  struct BloomMap {\
+    RBD(BloomMap, Map) map;\
+    RBD(BloomMap, Filter) filter;\
+  };\
+\
+  BloomMap *RBD(BloomMap, _cons)(BloomMap *bmap, size_t cap) {\
+    RBD(BloomMap, Map_cons)(&bmap->map, cap);\
+    RBD(BloomMap, Filter_cons)(&bmap->filter, cap);\
+    return bmap;\
+  }\
+\
+  bool RBD(BloomMap, _empty)(BloomMap *bmap) {\
+    return RBD(BloomMap, Map_empty)(&bmap->map);\
+  }\
+\
+  size_t RBD(BloomMap, _len)(BloomMap *bmap) {\
+    return RBD(BloomMap, Map_len)(&bmap->map);\
+  }\
+\
+  /* Add the key to the filter, rebuilding it from the table first if the table has outgrown it. */\
+  void RBD(BloomMap, _track)(BloomMap *bmap, Key key) {\
+    size_t len = RBD(BloomMap, Map_len)(&bmap->map);\
+    if (len <= RBD(BloomMap, Filter_cap)(&bmap->filter)) {\
+      RBD(BloomMap, Filter_insert)(&bmap->filter, key);\
+      return;\
+    }\
+    RBD(BloomMap, Filter_des)(&bmap->filter);\
+    RBD(BloomMap, Filter_cons)(&bmap->filter, len * 2);\
+    for (RBD(BloomMap, MapIter) iter = RBD(BloomMap, Map_begin)(&bmap->map); !RBD(BloomMap, MapIter_equals)(iter, RBD(BloomMap, Map_end)(&bmap->map)); iter = RBD(BloomMap, MapIter_next)(iter)) {\
+      RBD(BloomMap, Filter_insert)(&bmap->filter, *RBD(BloomMap, MapIter_key)(iter));\
+    }\
+  }\
+\
+  void RBD(BloomMap, _insert)(BloomMap *bmap, Key key, Val val) {\
+    RBD(BloomMap, Map_insert)(&bmap->map, key, val);\
+    RBD(BloomMap, _track)(bmap, key);\
+  }\
+\
+  Val *RBD(BloomMap, _emplace)(BloomMap *bmap, Key key) {\
+    Val *val = RBD(BloomMap, Map_emplace)(&bmap->map, key);\
+    RBD(BloomMap, _track)(bmap, key);\
+    return val;\
+  }\
+\
+  void RBD(BloomMap, _replace)(BloomMap *bmap, Key key, Val val) {\
+    RBD(BloomMap, Map_replace)(&bmap->map, key, val);\
+  }\
+\
+  Val *RBD(BloomMap, _remplace)(BloomMap *bmap, Key key) {\
+    return RBD(BloomMap, Map_remplace)(&bmap->map, key);\
+  }\
+\
+  Val *RBD(BloomMap, _at)(BloomMap *bmap, Key key) {\
+    return RBD(BloomMap, Map_at)(&bmap->map, key);\
+  }\
+\
+  RBD(BloomMap, MapIter) RBD(BloomMap, _find)(BloomMap *bmap, Key key) {\
+    if (!RBD(BloomMap, Filter_contains)(&bmap->filter, key)) {\
+      return RBD(BloomMap, Map_end)(&bmap->map);\
+    }\
+    return RBD(BloomMap, Map_find)(&bmap->map, key);\
+  }\
+\
+  bool RBD(BloomMap, _contains)(BloomMap *bmap, Key key) {\
+    return RBD(BloomMap, Filter_contains)(&bmap->filter, key) && RBD(BloomMap, Map_contains)(&bmap->map, key);\
+  }\
+\
+  void RBD(BloomMap, _erase)(BloomMap *bmap, Key key) {\
+    RBD(BloomMap, Filter_erase)(&bmap->filter, key);\
+    RBD(BloomMap, Map_erase)(&bmap->map, key);\
+  }\
+\
+  void RBD(BloomMap, _clear)(BloomMap *bmap) {\
+    RBD(BloomMap, Map_clear)(&bmap->map);\
+    RBD(BloomMap, Filter_clear)(&bmap->filter);\
+  }\
+\
+  RBD(BloomMap, MapIter) RBD(BloomMap, _begin)(BloomMap *bmap) {\
+    return RBD(BloomMap, Map_begin)(&bmap->map);\
+  }\
+\
+  RBD(BloomMap, MapIter) RBD(BloomMap, _end)(BloomMap *bmap) {\
+    return RBD(BloomMap, Map_end)(&bmap->map);\
+  }\
+\
+  void RBD(BloomMap, _debug)(BloomMap *bmap, FILE *file, uint32_t depth) {\
+    fprintf(file, #BloomMap " (%p) {\n", bmap);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "map: "); RBD(BloomMap, Map_debug)(&bmap->map, file, depth + 1); fprintf(file, ",\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "filter: "); RBD(BloomMap, Filter_debug)(&bmap->filter, file, depth + 1); fprintf(file, ",\n");\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  BloomMap *RBD(BloomMap, _des)(BloomMap *bmap) {\
+    RBD(BloomMap, Map_des)(&bmap->map);\
+    RBD(BloomMap, Filter_des)(&bmap->filter);\
+    return bmap;\
+  }
+
+#endif // RBD_BLOOM_H
@@ -0,0 +1,340 @@
+// vim: ft=c
+
+#ifndef RBD_CACHE_H
+#define RBD_CACHE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "rbddef.h"
+#include "rbdmap.h"
+#include "rbdpool.h"
+
+/* Initial capacity of the node pool shared by every cache of a type. The pool doubles from there as needed. */
+#define RBD_CACHE_POOL_CAP 64
+
+// RBD_CACHE_GEN_DECL(Cache, Key, Val)
+
+/* Generate the declarations for the cache. */
+#define RBD_CACHE_GEN_DECL(Cache, Key, Val)\
+\
+  /*=================================================================================================================*/\
+  /* Cache Node                                                                                                      */\
+  /*=================================================================================================================*/\
+\
+  /* Cache node. */\
+  typedef struct RBD(Cache, Node) RBD(Cache, Node);\
+\
+  /*=================================================================================================================*/\
+  /* Cache Node Pool                                                                                                 */\
+  /*=================================================================================================================*/\
+\
+  RBD_POOL_GEN_DECL(RBD(Cache, Pool), RBD(Cache, Node))\
+\
+  /*=================================================================================================================*/\
+  /* Cache Index                                                                                                     */\
+  /*=================================================================================================================*/\
+\
+  RBD_MAP_GEN_DECL(RBD(Cache, Map), Key, RBD(Cache, Node) *)\
+\
+  /*=================================================================================================================*/\
+  /* Cache                                                                                                           */\
+  /*=================================================================================================================*/\
+\
+  /* Cache. */\
+  typedef struct Cache Cache;\
+\
+  /* Construct a new cache holding at most the provided number of elements. */\
+  Cache *RBD(Cache, _cons)(Cache *cache, size_t cap);\
+\
+  /* Check if the cache is empty. */\
+  bool RBD(Cache, _empty)(Cache *cache);\
+\
+  /* Get the capacity of the cache. */\
+  size_t RBD(Cache, _cap)(Cache *cache);\
+\
+  /* Get the length of the cache (including expired elements not yet removed). */\
+  size_t RBD(Cache, _len)(Cache *cache);\
+\
+  /* Get the value of the provided key and mark it most recently used, or null if missing or expired. */\
+  Val *RBD(Cache, _get)(Cache *cache, Key key);\
+\
+  /* Same as `get`, but without updating recency. */\
+  Val *RBD(Cache, _peek)(Cache *cache, Key key);\
+\
+  /* Check if the key exists in the cache and has not expired. */\
+  bool RBD(Cache, _contains)(Cache *cache, Key key);\
+\
+  /* Insert or replace the value of the provided key, evicting the least recently used element if full. The element */\
+  /* expires after ttl clock ticks, or never if ttl is zero. If the key exists, the provided key is destructed. */\
+  void RBD(Cache, _put)(Cache *cache, Key key, Val val, uint64_t ttl);\
+\
+  /* Erase the provided key, returning false if it was missing. */\
+  bool RBD(Cache, _erase)(Cache *cache, Key key);\
+\
+  /* Evict the least recently used element, returning false if the cache is empty. */\
+  bool RBD(Cache, _evict)(Cache *cache);\
+\
+  /* Erase all expired elements, returning the number erased. */\
+  size_t RBD(Cache, _purge)(Cache *cache);\
+\
+  /* Clear all elements, calling key and value destructors for each element. */\
+  void RBD(Cache, _clear)(Cache *cache);\
+\
+  /* Print the underlying representation of the cache, calling key and value debug for each element. */\
+  void RBD(Cache, _debug)(Cache *cache, FILE *file, uint32_t depth);\
+\
+  /* Destruct the cache. */\
+  Cache *RBD(Cache, _des)(Cache *cache);
+
+// RBD_CACHE_GEN_DEF(Cache, Key, /*Key_hash*/, /*Key_equals*/, /*Key_debug*/, /*Key_des*/, Val, /*&*/, /*Val_debug*/, /*Val_des*/, /*Clock_now*/, /*Allocator_alloc*/, /*Allocator_free*/)
+
+/* Generate the definitions for the cache. Nodes come from the `CachePool` object pool shared by every cache of this */
+/* type. The pool is constructed when the first cache is and destructed with the last. The index is sized so that a */
+/* full cache fills at most a third of it, letting evictions rehash it in place instead of growing it. Without */
+/* `Clock_now` elements never expire. */
+#define RBD_CACHE_GEN_DEF(Cache, Key, Key_hash, Key_equals, Key_debug, Key_des, Val, Val_ref, Val_debug, Val_des, Clock_now, Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Cache Node                                                                                                      */\
+  /*=================================================================================================================*/\
+\
+  /* Cache node, linked into the recency list from most to least recently used. */\
+  struct RBD(Cache, Node) {\
+    RBD(Cache, Node) *prev;\
+    RBD(Cache, Node) *next;\
+    uint64_t expires;\
+    Key key;\
+    Val val;\
+  };\
+\
+  /* Unlink the cache node from the recency list. */\
+  void RBD(Cache, Node_unlink)(RBD(Cache, Node) *node) {\
+    node->prev->next = node->next;\
+    node->next->prev = node->prev;\
+  }\
+\
+  /* Link the cache node into the recency list after the provided node. */\
+  void RBD(Cache, Node_link)(RBD(Cache, Node) *node, RBD(Cache, Node) *prev) {\
+    node->prev = prev;\
+    node->next = prev->next;\
+    prev->next->prev = node;\
+    prev->next = node;\
+  }\
+\
+  /* Check if the cache node has expired. */\
+  bool RBD(Cache, Node_expired)(RBD_UNUSED RBD(Cache, Node) *node) {\
+    return RBD_IF(Clock_now)(node->expires <= Clock_now(), false);\
+  }\
+\
+  /* Print the underlying representation of the cache node with depth indentation. */\
+  void RBD(Cache, Node_debug)(RBD(Cache, Node) *node, FILE *file, uint32_t depth) {\
+    fprintf(file, #Cache "Node (%p) {\n", node);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "prev: %p,\n", node->prev);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "next: %p,\n", node->next);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "expires: %lu,\n", node->expires);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "key: "); RBD_IF(Key_debug)(Key_debug(node->key, file, depth + 1), fprintf(file, #Cache "Key { ? }")); fprintf(file, ",\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "val: "); RBD_IF(Val_debug)(Val_debug(Val_ref(node->val), file, depth + 1), fprintf(file, #Cache "Val { ? }")); fprintf(file, ",\n");\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  /* Destruct the cache node, calling key and value destructors, if necessary. */\
+  RBD(Cache, Node) *RBD(Cache, Node_des)(RBD(Cache, Node) *node) {\
+    RBD_IF(Key_des)(Key_des(node->key),);\
+    RBD_IF(Val_des)(Val_des(Val_ref(node->val)),);\
+    return node;\
+  }\
+\
+  /*=================================================================================================================*/\
+  /* Cache Node Pool                                                                                                 */\
+  /*=================================================================================================================*/\
+\
+  RBD_POOL_GEN_DEF(RBD(Cache, Pool), RBD(Cache, Node), Allocator_alloc, Allocator_free)\
+\
+  /* Number of live caches sharing the node pool. */\
+  static size_t RBD(Cache, Caches);\
+\
+  /*=================================================================================================================*/\
+  /* Cache Index                                                                                                     */\
+  /*=================================================================================================================*/\
+\
+  RBD_MAP_GEN_DEF(RBD(Cache, Map), Key, Key_hash, Key_equals, Key_debug, , RBD(Cache, Node) *, , , , , Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Cache                                                                                                           */\
+  /*=================================================================================================================*/\
+\
+  struct Cache {\
+    RBD(Cache, Map) map;\
+    RBD(Cache, Node) list;\
+    size_t cap;\
+  };\
+\
+  Cache *RBD(Cache, _cons)(Cache *cache, size_t cap) {\
+    if (!RBD(Cache, Caches)++) {\
+      RBD(Cache, Pool_cons)(RBD_CACHE_POOL_CAP);\
+    }\
+    RBD(Cache, Map_cons)(&cache->map, 3 * cap + 1);\
+    cache->list.prev = &cache->list;\
+    cache->list.next = &cache->list;\
+    cache->cap = cap;\
+    return cache;\
+  }\
+\
+  bool RBD(Cache, _empty)(Cache *cache) {\
+    return RBD(Cache, Map_empty)(&cache->map);\
+  }\
+\
+  size_t RBD(Cache, _cap)(Cache *cache) {\
+    return cache->cap;\
+  }\
+\
+  size_t RBD(Cache, _len)(Cache *cache) {\
+    return RBD(Cache, Map_len)(&cache->map);\
+  }\
+\
+  /* Remove the cache node from the index and recency list and return it to the pool. */\
+  void RBD(Cache, _remove)(Cache *cache, RBD(Cache, Node) *node) {\
+    RBD(Cache, Map_erase)(&cache->map, node->key);\
+    RBD(Cache, Node_unlink)(node);\
+    RBD(Cache, Node_des)(node);\
+    RBD(Cache, Pool_free)(node);\
+  }\
+\
+  /* Find the live cache node of the provided key, removing it if it has expired. */\
+  RBD(Cache, Node) *RBD(Cache, _lookup)(Cache *cache, Key key) {\
+    RBD(Cache, MapIter) iter = RBD(Cache, Map_find)(&cache->map, key);\
+    if (RBD(Cache, MapIter_equals)(iter, RBD(Cache, Map_end)(&cache->map))) {\
+      return NULL;\
+    }\
+    RBD(Cache, Node) *node = *RBD(Cache, MapIter_val)(iter);\
+    if (RBD(Cache, Node_expired)(node)) {\
+      RBD(Cache, Map_eraseIter)(&cache->map, iter);\
+      RBD(Cache, Node_unlink)(node);\
+      RBD(Cache, Node_des)(node);\
+      RBD(Cache, Pool_free)(node);\
+      return NULL;\
+    }\
+    return node;\
+  }\
+\
+  Val *RBD(Cache, _get)(Cache *cache, Key key) {\
+    RBD(Cache, Node) *node = RBD(Cache, _lookup)(cache, key);\
+    if (!node) {\
+      return NULL;\
+    }\
+    RBD(Cache, Node_unlink)(node);\
+    RBD(Cache, Node_link)(node, &cache->list);\
+    return &node->val;\
+  }\
+\
+  Val *RBD(Cache, _peek)(Cache *cache, Key key) {\
+    RBD(Cache, Node) *node = RBD(Cache, _lookup)(cache, key);\
+    return node ? &node->val : NULL;\
+  }\
+\
+  bool RBD(Cache, _contains)(Cache *cache, Key key) {\
+    return RBD(Cache, _lookup)(cache, key) != NULL;\
+  }\
+\
+  void RBD(Cache, _put)(Cache *cache, Key key, Val val, uint64_t ttl) {\
+    if (!cache->cap) {\
+      RBD_IF(Key_des)(Key_des(key),);\
+      RBD_IF(Val_des)(Val_des(Val_ref(val)),);\
+      return;\
+    }\
+    uint64_t expires = ttl ? RBD_IF(Clock_now)(Clock_now(), 0) + ttl : UINT64_MAX;\
+    RBD(Cache, MapIter) iter = RBD(Cache, Map_find)(&cache->map, key);\
+    RBD(Cache, Node) *node;\
+    if (!RBD(Cache, MapIter_equals)(iter, RBD(Cache, Map_end)(&cache->map))) {\
+      node = *RBD(Cache, MapIter_val)(iter);\
+      RBD_IF(Key_des)(Key_des(key),);\
+      RBD_IF(Val_des)(Val_des(Val_ref(node->val)),);\
+      RBD(Cache, Node_unlink)(node);\
+    } else {\
+      if (RBD(Cache, Map_len)(&cache->map) >= cache->cap) {\
+        node = cache->list.prev;\
+        RBD(Cache, Map_erase)(&cache->map, node->key);\
+        RBD(Cache, Node_unlink)(node);\
+        RBD(Cache, Node_des)(node);\
+      } else {\
+        node = RBD(Cache, Pool_alloc)();\
+      }\
+      node->key = key;\
+      RBD(Cache, Map_insert)(&cache->map, key, node);\
+    }\
+    node->val = val;\
+    node->expires = expires;\
+    RBD(Cache, Node_link)(node, &cache->list);\
+  }\
+\
+  bool RBD(Cache, _erase)(Cache *cache, Key key) {\
+    RBD(Cache, MapIter) iter = RBD(Cache, Map_find)(&cache->map, key);\
+    if (RBD(Cache, MapIter_equals)(iter, RBD(Cache, Map_end)(&cache->map))) {\
+      return false;\
+    }\
+    RBD(Cache, Node) *node = *RBD(Cache, MapIter_val)(iter);\
+    RBD(Cache, Map_eraseIter)(&cache->map, iter);\
+    RBD(Cache, Node_unlink)(node);\
+    RBD(Cache, Node_des)(node);\
+    RBD(Cache, Pool_free)(node);\
+    return true;\
+  }\
+\
+  bool RBD(Cache, _evict)(Cache *cache) {\
+    if (cache->list.prev == &cache->list) {\
+      return false;\
+    }\
+    RBD(Cache, _remove)(cache, cache->list.prev);\
+    return true;\
+  }\
+\
+  size_t RBD(Cache, _purge)(Cache *cache) {\
+    size_t n = 0;\
+    for (RBD(Cache, Node) *node = cache->list.next, *next; node != &cache->list; node = next) {\
+      next = node->next;\
+      if (RBD(Cache, Node_expired)(node)) {\
+        RBD(Cache, _remove)(cache, node);\
+        n++;\
+      }\
+    }\
+    return n;\
+  }\
+\
+  void RBD(Cache, _clear)(Cache *cache) {\
+    for (RBD(Cache, Node) *node = cache->list.next, *next; node != &cache->list; node = next) {\
+      next = node->next;\
+      RBD(Cache, Node_des)(node);\
+      RBD(Cache, Pool_free)(node);\
+    }\
+    cache->list.prev = &cache->list;\
+    cache->list.next = &cache->list;\
+    RBD(Cache, Map_clear)(&cache->map);\
+  }\
+\
+  void RBD(Cache, _debug)(Cache *cache, FILE *file, uint32_t depth) {\
+    fprintf(file, #Cache " (%p) {\n", cache);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "map: "); RBD(Cache, Map_debug)(&cache->map, file, depth + 1); fprintf(file, ",\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "list: [\n");\
+    for (RBD(Cache, Node) *node = cache->list.next; node != &cache->list; node = node->next) {\
+      RBD_INDENT(file, depth + 2); RBD(Cache, Node_debug)(node, file, depth + 2); fprintf(file, ",\n");\
+    }\
+    RBD_INDENT(file, depth + 1); fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "cap: %lu,\n", cache->cap);\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  Cache *RBD(Cache, _des)(Cache *cache) {\
+    RBD(Cache, _clear)(cache);\
+    RBD(Cache, Map_des)(&cache->map);\
+    if (!--RBD(Cache, Caches)) {\
+      RBD(Cache, Pool_des)();\
+      RBD(Cache, Pool).slabs = NULL;\
+    }\
+    return cache;\
+  }
+
+#endif // RBD_CACHE_H
@@ -4,6 +4,7 @@
 #define RBD_DEF_H
 
 #include <stdio.h>
+#include <stdint.h>
 
 #define RBD(a, b) a ## b
 
@@ -28,6 +29,25 @@
 
 #define RBD_UNUSED __attribute__((unused))
 
+#define RBD_CACHE_LINE 64
+
+/* Mix the bits of a 64-bit hash (splitmix64 finalizer, a bijection). */
+#define RBD_MIX(x) ({\
+  uint64_t _mix = (x);\
+  _mix ^= _mix >> 30;\
+  _mix *= 0xbf58476d1ce4e5b9ULL;\
+  _mix ^= _mix >> 27;\
+  _mix *= 0x94d049bb133111ebULL;\
+  _mix ^= _mix >> 31;\
+  _mix;\
+})
+
+/* Map a 64-bit hash uniformly onto [0, n) using its high bits. */
+#define RBD_RANGE(h, n) ((size_t)(((unsigned __int128)(h) * (n)) >> 64))
+
+/* Round up to the next power of two (at least one). */
+#define RBD_CEIL_POW2(n) ((n) <= 1 ? (size_t)1 : (size_t)1 << (8 * sizeof(unsigned long long) - __builtin_clzll((unsigned long long)(n) - 1)))
+
 #define RBD_INDENT(file, depth)\
   if (depth) {\
     fprintf(file, "%*c", (depth) * 2, ' ');\
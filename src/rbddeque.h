@@ -0,0 +1,390 @@
+// vim: ft=c
+
+#ifndef RBD_DEQUE_H
+#define RBD_DEQUE_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rbddef.h"
+
+// RBD_DEQUE_GEN_DECL(Deque, Elem);
+
+/* Generate the declarations for the deque. */
+#define RBD_DEQUE_GEN_DECL(Deque, Elem)\
+\
+  /*=================================================================================================================*/\
+  /* Deque Slice                                                                                                     */\
+  /*=================================================================================================================*/\
+\
+  /* Contiguous span of deque elements. */\
+  typedef struct RBD(Deque, Slice) RBD(Deque, Slice);\
+\
+  /*=================================================================================================================*/\
+  /* Deque Iterator                                                                                                  */\
+  /*=================================================================================================================*/\
+\
+  /* Deque iterator. */\
+  typedef struct RBD(Deque, Iter) RBD(Deque, Iter);\
+\
+  /* Deque. */\
+  typedef struct Deque Deque;\
+\
+  /* Construct a new deque iterator. */\
+  RBD(Deque, Iter) RBD(Deque, Iter_cons)(Deque *deque, size_t i);\
+\
+  /* Advance the deque iterator to the next element. */\
+  RBD(Deque, Iter) RBD(Deque, Iter_next)(RBD(Deque, Iter) iter);\
+\
+  /* Get the element at the current position. */\
+  Elem *RBD(Deque, Iter_elem)(RBD(Deque, Iter) iter);\
+\
+  /* Check if two iterators point to the same element. */\
+  bool RBD(Deque, Iter_equals)(RBD(Deque, Iter) a, RBD(Deque, Iter) b);\
+\
+  /* Print the underlying representation of the iterator with depth indentation. */\
+  void RBD(Deque, Iter_debug)(RBD(Deque, Iter) iter, FILE *file, uint32_t depth);\
+\
+  /* Destruct the deque iterator. */\
+  RBD(Deque, Iter) RBD(Deque, Iter_des)(RBD(Deque, Iter) iter);\
+\
+  /*=================================================================================================================*/\
+  /* Deque                                                                                                           */\
+  /*=================================================================================================================*/\
+\
+  /* Construct a new deque with initial capacity (rounded up to a power of two). */\
+  Deque *RBD(Deque, _cons)(Deque *deque, size_t cap);\
+\
+  /* Get pointer to element at the index, counting from the front. */\
+  Elem *RBD(Deque, _at)(Deque *deque, size_t i);\
+\
+  /* Get the capacity of the deque. */\
+  size_t RBD(Deque, _cap)(Deque *deque);\
+\
+  /* Get the length of the deque. */\
+  size_t RBD(Deque, _len)(Deque *deque);\
+\
+  /* Check if the deque is empty. */\
+  bool RBD(Deque, _empty)(Deque *deque);\
+\
+  /* Get the first element of the deque. */\
+  Elem *RBD(Deque, _front)(Deque *deque);\
+\
+  /* Get the last element of the deque. */\
+  Elem *RBD(Deque, _back)(Deque *deque);\
+\
+  /* Reserve at least the provided capacity (rounded up to a power of two). */\
+  void RBD(Deque, _reserve)(Deque *deque, size_t cap);\
+\
+  /* Push the provided element to the front of the deque, resizing as needed. */\
+  void RBD(Deque, _pushFront)(Deque *deque, Elem elem);\
+\
+  /* Same as `pushFront`, but returning a pointer to the element to-be-constructed. */\
+  Elem *RBD(Deque, _emplaceFront)(Deque *deque);\
+\
+  /* Push the provided element to the back of the deque, resizing as needed. */\
+  void RBD(Deque, _pushBack)(Deque *deque, Elem elem);\
+\
+  /* Same as `pushBack`, but returning a pointer to the element to-be-constructed. */\
+  Elem *RBD(Deque, _emplaceBack)(Deque *deque);\
+\
+  /* Remove the element at the front of the deque. */\
+  void RBD(Deque, _popFront)(Deque *deque);\
+\
+  /* Remove the element at the end of the deque. */\
+  void RBD(Deque, _popBack)(Deque *deque);\
+\
+  /* Push the provided elements to the back of the deque in at most two copies, resizing as needed. */\
+  void RBD(Deque, _pushBackN)(Deque *deque, Elem *elems, size_t n);\
+\
+  /* Same as `pushBackN`, but filling up to two slices of elements to-be-constructed (returns slice count). */\
+  size_t RBD(Deque, _emplaceBackN)(Deque *deque, size_t n, RBD(Deque, Slice) *slices);\
+\
+  /* Fill up to two slices covering the first n elements (returns slice count). */\
+  size_t RBD(Deque, _frontSlices)(Deque *deque, size_t n, RBD(Deque, Slice) *slices);\
+\
+  /* Remove the first n elements of the deque. */\
+  void RBD(Deque, _popFrontN)(Deque *deque, size_t n);\
+\
+  /* Remove the last n elements of the deque. */\
+  void RBD(Deque, _popBackN)(Deque *deque, size_t n);\
+\
+  /* Clear all elements and set length to zero, calling element destructor for each element. */\
+  void RBD(Deque, _clear)(Deque *deque);\
+\
+  /* Return iterator starting at first element. */\
+  RBD(Deque, Iter) RBD(Deque, _begin)(Deque *deque);\
+\
+  /* Return iterator starting after last element. */\
+  RBD(Deque, Iter) RBD(Deque, _end)(Deque *deque);\
+\
+  /* Checks if two deques are equal, calling element equals for each element, if necessary. */\
+  bool RBD(Deque, _equals)(Deque *a, Deque *b);\
+\
+  /* Print the underlying representation of the deque, calling element debug for each element. */\
+  void RBD(Deque, _debug)(Deque *deque, FILE *file, uint32_t depth);\
+\
+  /* Destruct the deque. */\
+  Deque *RBD(Deque, _des)(Deque *deque);
+
+// RBD_DEQUE_GEN_DEF(Deque, Elem, /*&*/, /*Elem_equals*/, /*Elem_debug*/, /*Elem_des*/, /*Allocator_alloc*/, /*Allocator_realloc*/, /*Allocator_free*/);
+
+/* Generate the definitions for the deque. */
+#define RBD_DEQUE_GEN_DEF(Deque, Elem, Elem_ref, Elem_equals, Elem_debug, Elem_des, Allocator_alloc, Allocator_realloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Deque Slice                                                                                                     */\
+  /*=================================================================================================================*/\
+\
+  struct RBD(Deque, Slice) {\
+    Elem *elems;\
+    size_t len;\
+  };\
+\
+  /*=================================================================================================================*/\
+  /* Deque Iterator                                                                                                  */\
+  /*=================================================================================================================*/\
+\
+  struct RBD(Deque, Iter) {\
+    Deque *deque;\
+    size_t i;\
+  };\
+\
+  RBD(Deque, Iter) RBD(Deque, Iter_cons)(Deque *deque, size_t i) {\
+    return (RBD(Deque, Iter)) {\
+      .deque = deque,\
+      .i = i,\
+    };\
+  }\
+\
+  RBD(Deque, Iter) RBD(Deque, Iter_next)(RBD(Deque, Iter) iter) {\
+    iter.i++;\
+    return iter;\
+  }\
+\
+  Elem *RBD(Deque, Iter_elem)(RBD(Deque, Iter) iter) {\
+    return RBD(Deque, _at)(iter.deque, iter.i);\
+  }\
+\
+  bool RBD(Deque, Iter_equals)(RBD(Deque, Iter) a, RBD(Deque, Iter) b) {\
+    return (a.deque == b.deque) && (a.i == b.i);\
+  }\
+\
+  void RBD(Deque, Iter_debug)(RBD(Deque, Iter) iter, FILE *file, RBD_UNUSED uint32_t depth) {\
+    fprintf(file, #Deque "Iter { deque: %p, i: %lu }", iter.deque, iter.i);\
+  }\
+\
+  RBD(Deque, Iter) RBD(Deque, Iter_des)(RBD(Deque, Iter) iter) {\
+    return iter;\
+  }\
+\
+  /*=================================================================================================================*/\
+  /* Deque                                                                                                           */\
+  /*=================================================================================================================*/\
+\
+  struct Deque {\
+    Elem *elems;\
+    size_t cap;\
+    size_t head;\
+    size_t len;\
+  };\
+\
+  Deque *RBD(Deque, _cons)(Deque *deque, size_t cap) {\
+    cap = RBD_CEIL_POW2(cap);\
+    *deque = (Deque) {\
+      .elems = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(cap * sizeof(Elem)),\
+      .cap = cap,\
+      .head = 0,\
+      .len = 0,\
+    };\
+    return deque;\
+  }\
+\
+  Elem *RBD(Deque, _at)(Deque *deque, size_t i) {\
+    return &deque->elems[(deque->head + i) & (deque->cap - 1)];\
+  }\
+\
+  size_t RBD(Deque, _cap)(Deque *deque) {\
+    return deque->cap;\
+  }\
+\
+  size_t RBD(Deque, _len)(Deque *deque) {\
+    return deque->len;\
+  }\
+\
+  bool RBD(Deque, _empty)(Deque *deque) {\
+    return !deque->len;\
+  }\
+\
+  Elem *RBD(Deque, _front)(Deque *deque) {\
+    return &deque->elems[deque->head];\
+  }\
+\
+  Elem *RBD(Deque, _back)(Deque *deque) {\
+    return RBD(Deque, _at)(deque, deque->len - 1);\
+  }\
+\
+  /* Reserve the provided power-of-two capacity, assuming capacity is larger than current. The wrapped part of the */\
+  /* ring is unwrapped by moving whichever of the two segments is shorter. */\
+  void RBD(Deque, _reserveUnchecked)(Deque *deque, size_t cap) {\
+    size_t oldCap = deque->cap;\
+    deque->elems = RBD_IF(Allocator_realloc)(Allocator_realloc, realloc)(deque->elems, cap * sizeof(Elem));\
+    deque->cap = cap;\
+    if (deque->head + deque->len > oldCap) {\
+      size_t wrapped = deque->head + deque->len - oldCap;\
+      size_t unwrapped = oldCap - deque->head;\
+      if (wrapped <= unwrapped) {\
+        memcpy(&deque->elems[oldCap], &deque->elems[0], wrapped * sizeof(Elem));\
+      } else {\
+        memcpy(&deque->elems[cap - unwrapped], &deque->elems[deque->head], unwrapped * sizeof(Elem));\
+        deque->head = cap - unwrapped;\
+      }\
+    }\
+  }\
+\
+  void RBD(Deque, _reserve)(Deque *deque, size_t cap) {\
+    if (cap > deque->cap) {\
+      RBD(Deque, _reserveUnchecked)(deque, RBD_CEIL_POW2(cap));\
+    }\
+  }\
+\
+  void RBD(Deque, _pushFront)(Deque *deque, Elem elem) {\
+    *RBD(Deque, _emplaceFront)(deque) = elem;\
+  }\
+\
+  Elem *RBD(Deque, _emplaceFront)(Deque *deque) {\
+    if (deque->len == deque->cap) {\
+      RBD(Deque, _reserveUnchecked)(deque, deque->cap * 2);\
+    }\
+    deque->head = (deque->head - 1) & (deque->cap - 1);\
+    deque->len++;\
+    return &deque->elems[deque->head];\
+  }\
+\
+  void RBD(Deque, _pushBack)(Deque *deque, Elem elem) {\
+    *RBD(Deque, _emplaceBack)(deque) = elem;\
+  }\
+\
+  Elem *RBD(Deque, _emplaceBack)(Deque *deque) {\
+    if (deque->len == deque->cap) {\
+      RBD(Deque, _reserveUnchecked)(deque, deque->cap * 2);\
+    }\
+    return RBD(Deque, _at)(deque, deque->len++);\
+  }\
+\
+  void RBD(Deque, _popFront)(Deque *deque) {\
+    RBD_IF(Elem_des)(Elem_des(Elem_ref(deque->elems[deque->head])),);\
+    deque->head = (deque->head + 1) & (deque->cap - 1);\
+    deque->len--;\
+  }\
+\
+  void RBD(Deque, _popBack)(Deque *deque) {\
+    deque->len--;\
+    RBD_IF(Elem_des)(Elem_des(Elem_ref(*RBD(Deque, _at)(deque, deque->len))),);\
+  }\
+\
+  /* Get up to two slices covering n elements starting at the index, assuming they are in bounds of the capacity. */\
+  size_t RBD(Deque, _slices)(Deque *deque, size_t i, size_t n, RBD(Deque, Slice) *slices) {\
+    if (!n) {\
+      return 0;\
+    }\
+    size_t start = (deque->head + i) & (deque->cap - 1);\
+    size_t first = deque->cap - start;\
+    if (n <= first) {\
+      slices[0] = (RBD(Deque, Slice)) { .elems = &deque->elems[start], .len = n };\
+      return 1;\
+    }\
+    slices[0] = (RBD(Deque, Slice)) { .elems = &deque->elems[start], .len = first };\
+    slices[1] = (RBD(Deque, Slice)) { .elems = &deque->elems[0], .len = n - first };\
+    return 2;\
+  }\
+\
+  void RBD(Deque, _pushBackN)(Deque *deque, Elem *elems, size_t n) {\
+    RBD(Deque, Slice) slices[2];\
+    size_t count = RBD(Deque, _emplaceBackN)(deque, n, slices);\
+    for (size_t i = 0, j = 0; i < count; j += slices[i].len, i++) {\
+      memcpy(slices[i].elems, &elems[j], slices[i].len * sizeof(Elem));\
+    }\
+  }\
+\
+  size_t RBD(Deque, _emplaceBackN)(Deque *deque, size_t n, RBD(Deque, Slice) *slices) {\
+    RBD(Deque, _reserve)(deque, deque->len + n);\
+    size_t count = RBD(Deque, _slices)(deque, deque->len, n, slices);\
+    deque->len += n;\
+    return count;\
+  }\
+\
+  size_t RBD(Deque, _frontSlices)(Deque *deque, size_t n, RBD(Deque, Slice) *slices) {\
+    return RBD(Deque, _slices)(deque, 0, n, slices);\
+  }\
+\
+  void RBD(Deque, _popFrontN)(Deque *deque, size_t n) {\
+    for (size_t i = 0; i < n; i++) {\
+      RBD_IF(Elem_des)(Elem_des(Elem_ref(*RBD(Deque, _at)(deque, i))),);\
+    }\
+    deque->head = (deque->head + n) & (deque->cap - 1);\
+    deque->len -= n;\
+  }\
+\
+  void RBD(Deque, _popBackN)(Deque *deque, size_t n) {\
+    for (size_t i = deque->len - n; i < deque->len; i++) {\
+      RBD_IF(Elem_des)(Elem_des(Elem_ref(*RBD(Deque, _at)(deque, i))),);\
+    }\
+    deque->len -= n;\
+  }\
+\
+  void RBD(Deque, _clear)(Deque *deque) {\
+    for (size_t i = 0; i < deque->len; i++) {\
+      RBD_IF(Elem_des)(Elem_des(Elem_ref(*RBD(Deque, _at)(deque, i))),);\
+    }\
+    deque->head = 0;\
+    deque->len = 0;\
+  }\
+\
+  RBD(Deque, Iter) RBD(Deque, _begin)(Deque *deque) {\
+    return RBD(Deque, Iter_cons)(deque, 0);\
+  }\
+\
+  RBD(Deque, Iter) RBD(Deque, _end)(Deque *deque) {\
+    return RBD(Deque, Iter_cons)(deque, deque->len);\
+  }\
+\
+  bool RBD(Deque, _equals)(Deque *a, Deque *b) {\
+    if (a->len != b->len) {\
+      return false;\
+    }\
+    for (size_t i = 0; i < a->len; i++) {\
+      Elem *x = RBD(Deque, _at)(a, i), *y = RBD(Deque, _at)(b, i);\
+      if (!RBD_IF(Elem_equals)(Elem_equals(Elem_ref(*x), Elem_ref(*y)), (*x == *y))) {\
+        return false;\
+      }\
+    }\
+    return true;\
+  }\
+\
+  void RBD(Deque, _debug)(Deque *deque, FILE *file, uint32_t depth) {\
+    fprintf(file, #Deque " (%p) {\n", deque);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "elems: (%p) [\n", deque->elems);\
+    for (size_t i = 0; i < deque->len; i++) {\
+      RBD_INDENT(file, depth + 2); RBD_IF(Elem_debug)(Elem_debug(Elem_ref(*RBD(Deque, _at)(deque, i)), file, depth + 2), fprintf(file, #Deque "Elem { ? }")); fprintf(file, ",\n");\
+    }\
+    RBD_INDENT(file, depth + 1); fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "cap: %lu,\n", deque->cap);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "head: %lu,\n", deque->head);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "len: %lu,\n", deque->len);\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  Deque *RBD(Deque, _des)(Deque *deque) {\
+    for (size_t i = 0; i < deque->len; i++) {\
+      RBD_IF(Elem_des)(Elem_des(Elem_ref(*RBD(Deque, _at)(deque, i))),);\
+    }\
+    RBD_IF(Allocator_free)(Allocator_free, free)(deque->elems);\
+    return deque;\
+  }
+
+#endif // RBD_DEQUE_H
@@ -0,0 +1,341 @@
+// vim: ft=c
+
+#ifndef RBD_FROZENMAP_H
+#define RBD_FROZENMAP_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rbddef.h"
+#include "rbdmap.h"
+
+/* Average number of keys per bucket of pilots. */
+#define RBD_FROZENMAP_BUCKET_LEN 4
+
+// RBD_FROZENMAP_GEN_DECL(FrozenMap, Map, Key, Val)
+
+/* Generate the declarations for the frozen map. */
+#define RBD_FROZENMAP_GEN_DECL(FrozenMap, Map, Key, Val)\
+\
+  /*=================================================================================================================*/\
+  /* Frozen Map Entry                                                                                                */\
+  /*=================================================================================================================*/\
+\
+  /* Frozen map entry. */\
+  typedef struct RBD(FrozenMap, Entry) RBD(FrozenMap, Entry);\
+\
+  /*=================================================================================================================*/\
+  /* Frozen Map Iterator                                                                                             */\
+  /*=================================================================================================================*/\
+\
+  /* Frozen map iterator. */\
+  typedef struct RBD(FrozenMap, Iter) RBD(FrozenMap, Iter);\
+\
+  /* Construct a new frozen map iterator. */\
+  RBD(FrozenMap, Iter) RBD(FrozenMap, Iter_cons)(RBD(FrozenMap, Entry) *entry);\
+\
+  /* Advance the frozen map iterator to the next element. */\
+  RBD(FrozenMap, Iter) RBD(FrozenMap, Iter_next)(RBD(FrozenMap, Iter) iter);\
+\
+  /* Get the key at the current position. */\
+  Key *RBD(FrozenMap, Iter_key)(RBD(FrozenMap, Iter) iter);\
+\
+  /* Get the value at the current position. */\
+  Val *RBD(FrozenMap, Iter_val)(RBD(FrozenMap, Iter) iter);\
+\
+  /* Check if two iterators point to the same element. */\
+  bool RBD(FrozenMap, Iter_equals)(RBD(FrozenMap, Iter) a, RBD(FrozenMap, Iter) b);\
+\
+  /* Print the underlying representation of the iterator with depth indentation. */\
+  void RBD(FrozenMap, Iter_debug)(RBD(FrozenMap, Iter) iter, FILE *file, uint32_t depth);\
+\
+  /* Destruct the frozen map iterator. */\
+  RBD(FrozenMap, Iter) RBD(FrozenMap, Iter_des)(RBD(FrozenMap, Iter) iter);\
+\
+  /*=================================================================================================================*/\
+  /* Frozen Map                                                                                                      */\
+  /*=================================================================================================================*/\
+\
+  /* Frozen map. */\
+  typedef struct FrozenMap FrozenMap;\
+\
+  /* Construct a new frozen map by moving every element out of the map, leaving it empty. Returns null, leaving the */\
+  /* map untouched, if two keys have the same hash. */\
+  FrozenMap *RBD(FrozenMap, _cons)(FrozenMap *fmap, Map *map);\
+\
+  /* Check if the frozen map is empty. */\
+  bool RBD(FrozenMap, _empty)(FrozenMap *fmap);\
+\
+  /* Get the length of the frozen map. */\
+  size_t RBD(FrozenMap, _len)(FrozenMap *fmap);\
+\
+  /* Get the value of the provided key (must exist). */\
+  Val *RBD(FrozenMap, _at)(FrozenMap *fmap, Key key);\
+\
+  /* Get the value of the provided key, or null if it does not exist. */\
+  Val *RBD(FrozenMap, _get)(FrozenMap *fmap, Key key);\
+\
+  /* Check if the key exists in the frozen map. */\
+  bool RBD(FrozenMap, _contains)(FrozenMap *fmap, Key key);\
+\
+  /* Return iterator starting at first element. */\
+  RBD(FrozenMap, Iter) RBD(FrozenMap, _begin)(FrozenMap *fmap);\
+\
+  /* Return iterator starting after last element. */\
+  RBD(FrozenMap, Iter) RBD(FrozenMap, _end)(FrozenMap *fmap);\
+\
+  /* Print the underlying representation of the frozen map, calling key and value debug for each element. */\
+  void RBD(FrozenMap, _debug)(FrozenMap *fmap, FILE *file, uint32_t depth);\
+\
+  /* Destruct the frozen map. */\
+  FrozenMap *RBD(FrozenMap, _des)(FrozenMap *fmap);
+
+// RBD_FROZENMAP_GEN_DEF(FrozenMap, Map, Key, /*Key_hash*/, /*Key_equals*/, /*Key_debug*/, /*Key_des*/, Val, /*&*/, /*Val_debug*/, /*Val_des*/, /*Allocator_alloc*/, /*Allocator_free*/)
+
+/* Generate the definitions for the frozen map. Keys are placed with a PTHash-style minimal perfect hash: every key */
+/* hashes to a bucket whose pilot displaces it to a distinct entry, so a lookup is exactly one probe into a fully */
+/* packed entry array. `Map` must be defined in the same translation unit with the same key callbacks. */
+#define RBD_FROZENMAP_GEN_DEF(FrozenMap, Map, Key, Key_hash, Key_equals, Key_debug, Key_des, Val, Val_ref, Val_debug, Val_des, Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Frozen Map Entry                                                                                                */\
+  /*=================================================================================================================*/\
+\
+  struct RBD(FrozenMap, Entry) {\
+    Key key;\
+    Val val;\
+  };\
+\
+  /*=================================================================================================================*/\
+  /* Frozen Map Iterator                                                                                             */\
+  /*=================================================================================================================*/\
+\
+  struct RBD(FrozenMap, Iter) {\
+    RBD(FrozenMap, Entry) *entry;\
+  };\
+\
+  RBD(FrozenMap, Iter) RBD(FrozenMap, Iter_cons)(RBD(FrozenMap, Entry) *entry) {\
+    return (RBD(FrozenMap, Iter)) {\
+      .entry = entry,\
+    };\
+  }\
+\
+  RBD(FrozenMap, Iter) RBD(FrozenMap, Iter_next)(RBD(FrozenMap, Iter) iter) {\
+    iter.entry++;\
+    return iter;\
+  }\
+\
+  Key *RBD(FrozenMap, Iter_key)(RBD(FrozenMap, Iter) iter) {\
+    return &iter.entry->key;\
+  }\
+\
+  Val *RBD(FrozenMap, Iter_val)(RBD(FrozenMap, Iter) iter) {\
+    return &iter.entry->val;\
+  }\
+\
+  bool RBD(FrozenMap, Iter_equals)(RBD(FrozenMap, Iter) a, RBD(FrozenMap, Iter) b) {\
+    return (a.entry == b.entry);\
+  }\
+\
+  void RBD(FrozenMap, Iter_debug)(RBD(FrozenMap, Iter) iter, FILE *file, RBD_UNUSED uint32_t depth) {\
+    fprintf(file, #FrozenMap "Iter { entry: %p }", iter.entry);\
+  }\
+\
+  RBD(FrozenMap, Iter) RBD(FrozenMap, Iter_des)(RBD(FrozenMap, Iter) iter) {\
+    return iter;\
+  }\
+\
+  /*=================================================================================================================*/\
+  /* Frozen Map                                                                                                      */\
+  /*=================================================================================================================*/\
+\
+  /* Entries and pilots share one allocation, with the pilots following the entries. */\
+  struct FrozenMap {\
+    RBD(FrozenMap, Entry) *entries;\
+    uint32_t *pilots;\
+    size_t len;\
+    size_t buckets;\
+  };\
+\
+  /* Hash the key. */\
+  uint64_t RBD(FrozenMap, _hash)(Key key) {\
+    return RBD_MIX((uint64_t)RBD_IF(Key_hash)(Key_hash(key), (size_t)key));\
+  }\
+\
+  /* Get the bucket of the hash, using its low bits. */\
+  size_t RBD(FrozenMap, _bucket)(FrozenMap *fmap, uint64_t hash) {\
+    return (size_t)(((hash & 0xffffffff) * fmap->buckets) >> 32);\
+  }\
+\
+  /* Get the entry index of the hash displaced by the pilot. The displaced hash is remixed so that keys agreeing in */\
+  /* their high bits are separated by some pilot. */\
+  size_t RBD(FrozenMap, _slot)(FrozenMap *fmap, uint64_t hash, uint32_t pilot) {\
+    return RBD_RANGE(RBD_MIX(hash + pilot * 0x9e3779b97f4a7c15ULL), fmap->len);\
+  }\
+\
+  FrozenMap *RBD(FrozenMap, _cons)(FrozenMap *fmap, Map *map) {\
+    size_t len = RBD(Map, _len)(map);\
+    size_t buckets = len / RBD_FROZENMAP_BUCKET_LEN + 1;\
+    size_t offset = (len * sizeof(RBD(FrozenMap, Entry)) + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);\
+    *fmap = (FrozenMap) {\
+      .len = len,\
+      .buckets = buckets,\
+    };\
+    uint64_t *hashes = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(len * sizeof(uint64_t));\
+    RBD(Map, Iter) *iters = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(len * sizeof(RBD(Map, Iter)));\
+    size_t *starts = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)((buckets + 1) * sizeof(size_t));\
+    size_t *order = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)((len + 1) * sizeof(size_t));\
+    size_t *slots = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)((len + 1) * sizeof(size_t));\
+    uint64_t *taken = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)((len / 64 + 1) * sizeof(uint64_t));\
+    uint32_t *pilots = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(buckets * sizeof(uint32_t));\
+    memset(starts, 0, (buckets + 1) * sizeof(size_t));\
+    memset(taken, 0, (len / 64 + 1) * sizeof(uint64_t));\
+    /* Group the keys by bucket with a counting sort. */\
+    size_t n = 0;\
+    for (RBD(Map, Iter) iter = RBD(Map, _begin)(map); !RBD(Map, Iter_equals)(iter, RBD(Map, _end)(map)); iter = RBD(Map, Iter_next)(iter)) {\
+      hashes[n] = RBD(FrozenMap, _hash)(*RBD(Map, Iter_key)(iter));\
+      iters[n] = iter;\
+      starts[RBD(FrozenMap, _bucket)(fmap, hashes[n])]++;\
+      n++;\
+    }\
+    size_t maxBucketLen = starts[0];\
+    for (size_t b = 0; b < buckets; b++) {\
+      maxBucketLen = (starts[b + 1] > maxBucketLen) ? starts[b + 1] : maxBucketLen;\
+      starts[b + 1] += starts[b];\
+    }\
+    for (size_t i = 0; i < len; i++) {\
+      order[--starts[RBD(FrozenMap, _bucket)(fmap, hashes[i])]] = i;\
+    }\
+    /* Place buckets from largest to smallest, searching for a pilot that sends every key to a free entry. */\
+    bool ok = true;\
+    for (size_t bucketLen = maxBucketLen; ok && bucketLen > 0; bucketLen--) {\
+      for (size_t b = 0; ok && b < buckets; b++) {\
+        size_t start = starts[b], end = starts[b + 1];\
+        if (end - start != bucketLen) {\
+          continue;\
+        }\
+        for (uint32_t pilot = 0; ; pilot++) {\
+          size_t i = start;\
+          for (; i < end; i++) {\
+            size_t slot = RBD(FrozenMap, _slot)(fmap, hashes[order[i]], pilot);\
+            if (taken[slot / 64] & ((uint64_t)1 << (slot % 64))) {\
+              break;\
+            }\
+            taken[slot / 64] |= (uint64_t)1 << (slot % 64);\
+            slots[i] = slot;\
+          }\
+          if (i == end) {\
+            pilots[b] = pilot;\
+            break;\
+          }\
+          for (size_t j = start; j < i; j++) {\
+            taken[slots[j] / 64] &= ~((uint64_t)1 << (slots[j] % 64));\
+          }\
+          for (size_t j = start; j < i; j++) {\
+            if (hashes[order[j]] == hashes[order[i]]) {\
+              ok = false;\
+            }\
+          }\
+          if (!ok || pilot == UINT32_MAX) {\
+            ok = false;\
+            break;\
+          }\
+        }\
+      }\
+    }\
+    if (ok) {\
+      fmap->entries = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(offset + buckets * sizeof(uint32_t));\
+      fmap->pilots = (uint32_t *)((char *)fmap->entries + offset);\
+      memcpy(fmap->pilots, pilots, buckets * sizeof(uint32_t));\
+      for (size_t i = 0; i < len; i++) {\
+        fmap->entries[slots[i]] = (RBD(FrozenMap, Entry)) {\
+          .key = *RBD(Map, Iter_key)(iters[order[i]]),\
+          .val = *RBD(Map, Iter_val)(iters[order[i]]),\
+        };\
+      }\
+      for (size_t i = 0; i < map->cap; i++) {\
+        RBD(Map, Elem_consUnused)(&map->elems[i]);\
+      }\
+      map->len = 0;\
+      map->erased = 0;\
+    }\
+    RBD_IF(Allocator_free)(Allocator_free, free)(hashes);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(iters);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(starts);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(order);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(slots);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(taken);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(pilots);\
+    return ok ? fmap : NULL;\
+  }\
+\
+  bool RBD(FrozenMap, _empty)(FrozenMap *fmap) {\
+    return !fmap->len;\
+  }\
+\
+  size_t RBD(FrozenMap, _len)(FrozenMap *fmap) {\
+    return fmap->len;\
+  }\
+\
+  /* Get the only entry the key can occupy. */\
+  RBD(FrozenMap, Entry) *RBD(FrozenMap, _entry)(FrozenMap *fmap, Key key) {\
+    uint64_t hash = RBD(FrozenMap, _hash)(key);\
+    return &fmap->entries[RBD(FrozenMap, _slot)(fmap, hash, fmap->pilots[RBD(FrozenMap, _bucket)(fmap, hash)])];\
+  }\
+\
+  Val *RBD(FrozenMap, _at)(FrozenMap *fmap, Key key) {\
+    return &RBD(FrozenMap, _entry)(fmap, key)->val;\
+  }\
+\
+  Val *RBD(FrozenMap, _get)(FrozenMap *fmap, Key key) {\
+    if (!fmap->len) {\
+      return NULL;\
+    }\
+    RBD(FrozenMap, Entry) *entry = RBD(FrozenMap, _entry)(fmap, key);\
+    return RBD_IF(Key_equals)(Key_equals(entry->key, key), entry->key == key) ? &entry->val : NULL;\
+  }\
+\
+  bool RBD(FrozenMap, _contains)(FrozenMap *fmap, Key key) {\
+    return RBD(FrozenMap, _get)(fmap, key) != NULL;\
+  }\
+\
+  RBD(FrozenMap, Iter) RBD(FrozenMap, _begin)(FrozenMap *fmap) {\
+    return RBD(FrozenMap, Iter_cons)(&fmap->entries[0]);\
+  }\
+\
+  RBD(FrozenMap, Iter) RBD(FrozenMap, _end)(FrozenMap *fmap) {\
+    return RBD(FrozenMap, Iter_cons)(&fmap->entries[fmap->len]);\
+  }\
+\
+  void RBD(FrozenMap, _debug)(FrozenMap *fmap, FILE *file, uint32_t depth) {\
+    fprintf(file, #FrozenMap " (%p) {\n", fmap);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "entries: (%p) [\n", fmap->entries);\
+    for (size_t i = 0; i < fmap->len; i++) {\
+      RBD_INDENT(file, depth + 2); fprintf(file, "{ key: "); RBD_IF(Key_debug)(Key_debug(fmap->entries[i].key, file, depth + 2), fprintf(file, #FrozenMap "Key { ? }"));\
+      fprintf(file, ", val: "); RBD_IF(Val_debug)(Val_debug(Val_ref(fmap->entries[i].val), file, depth + 2), fprintf(file, #FrozenMap "Val { ? }")); fprintf(file, " },\n");\
+    }\
+    RBD_INDENT(file, depth + 1); fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "pilots: (%p) [", fmap->pilots);\
+    for (size_t i = 0; i < fmap->buckets; i++) {\
+      fprintf(file, i ? ", %u" : "%u", fmap->pilots[i]);\
+    }\
+    fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "len: %lu,\n", fmap->len);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "buckets: %lu,\n", fmap->buckets);\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  FrozenMap *RBD(FrozenMap, _des)(FrozenMap *fmap) {\
+    for (size_t i = 0; i < fmap->len; i++) {\
+      RBD_IF(Key_des)(Key_des(fmap->entries[i].key),);\
+      RBD_IF(Val_des)(Val_des(Val_ref(fmap->entries[i].val)),);\
+    }\
+    RBD_IF(Allocator_free)(Allocator_free, free)(fmap->entries);\
+    return fmap;\
+  }
+
+#endif // RBD_FROZENMAP_H
@@ -0,0 +1,474 @@
+// vim: ft=c
+
+#ifndef RBD_HEAP_H
+#define RBD_HEAP_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "rbddef.h"
+#include "rbdlist.h"
+
+/* Default number of children per heap node; four children of a node usually share a cache line. */
+#define RBD_HEAP_ARITY 4
+
+/* Index that marks an indexed heap id as absent. */
+#define RBD_HEAP_ABSENT SIZE_MAX
+
+// RBD_HEAP_GEN_DECL(Heap, List, Elem)
+
+/* Generate the declarations for the heap. */
+#define RBD_HEAP_GEN_DECL(Heap, List, Elem)\
+\
+  /*=================================================================================================================*/\
+  /* Heap                                                                                                            */\
+  /*=================================================================================================================*/\
+\
+  /* Heap. */\
+  typedef struct Heap Heap;\
+\
+  /* Construct a new heap with initial capacity. */\
+  Heap *RBD(Heap, _cons)(Heap *heap, size_t cap);\
+\
+  /* Construct a new heap by taking over the storage of the list and heapifying it in linear time. The list must not */\
+  /* be used or destructed afterwards. */\
+  Heap *RBD(Heap, _heapify)(Heap *heap, List *list);\
+\
+  /* Check if the heap is empty. */\
+  bool RBD(Heap, _empty)(Heap *heap);\
+\
+  /* Get the length of the heap. */\
+  size_t RBD(Heap, _len)(Heap *heap);\
+\
+  /* Get the underlying list, in heap order. */\
+  List *RBD(Heap, _list)(Heap *heap);\
+\
+  /* Get the least element (heap must not be empty). */\
+  Elem *RBD(Heap, _top)(Heap *heap);\
+\
+  /* Push an element onto the heap. */\
+  void RBD(Heap, _push)(Heap *heap, Elem elem);\
+\
+  /* Push n elements onto the heap, re-heapifying at once when that is cheaper than pushing one by one. */\
+  void RBD(Heap, _pushN)(Heap *heap, Elem *elems, size_t n);\
+\
+  /* Pop the least element (heap must not be empty). */\
+  Elem RBD(Heap, _pop)(Heap *heap);\
+\
+  /* Pop the least element and push the provided element in a single pass (heap must not be empty). */\
+  Elem RBD(Heap, _replace)(Heap *heap, Elem elem);\
+\
+  /* Clear all elements and set length to zero, calling element destructor for each element. */\
+  void RBD(Heap, _clear)(Heap *heap);\
+\
+  /* Print the underlying representation of the heap, calling element debug for each element. */\
+  void RBD(Heap, _debug)(Heap *heap, FILE *file, uint32_t depth);\
+\
+  /* Destruct the heap. */\
+  Heap *RBD(Heap, _des)(Heap *heap);
+
+// RBD_HEAP_GEN_DEF(Heap, List, Elem, /*&*/, /*Elem_compare*/, /*Arity*/)
+
+/* Generate the definitions for the heap, a d-ary min-heap stored in a `List` generated for the same element type. */
+/* Use a reversed compare for a max-heap. */
+#define RBD_HEAP_GEN_DEF(Heap, List, Elem, Elem_ref, Elem_compare, Arity)\
+\
+  /*=================================================================================================================*/\
+  /* Heap                                                                                                            */\
+  /*=================================================================================================================*/\
+\
+  struct Heap {\
+    List list;\
+  };\
+\
+  /* Move the element at i up to its place. */\
+  void RBD(Heap, _siftUp)(Elem *elems, size_t i) {\
+    Elem elem = elems[i];\
+    while (i > 0) {\
+      size_t p = (i - 1) / RBD_IF(Arity)(Arity, RBD_HEAP_ARITY);\
+      if (!RBD_LIST_LESS(Elem_ref, Elem_compare, elem, elems[p])) {\
+        break;\
+      }\
+      elems[i] = elems[p];\
+      i = p;\
+    }\
+    elems[i] = elem;\
+  }\
+\
+  /* Move the provided element down from i to its place among the first n elements. */\
+  void RBD(Heap, _siftDown)(Elem *elems, size_t i, size_t n, Elem elem) {\
+    for (;;) {\
+      size_t c = i * RBD_IF(Arity)(Arity, RBD_HEAP_ARITY) + 1;\
+      if (c >= n) {\
+        break;\
+      }\
+      size_t end = (n - c < RBD_IF(Arity)(Arity, RBD_HEAP_ARITY)) ? n : c + RBD_IF(Arity)(Arity, RBD_HEAP_ARITY), best = c;\
+      for (size_t k = c + 1; k < end; k++) {\
+        if (RBD_LIST_LESS(Elem_ref, Elem_compare, elems[k], elems[best])) {\
+          best = k;\
+        }\
+      }\
+      if (!RBD_LIST_LESS(Elem_ref, Elem_compare, elems[best], elem)) {\
+        break;\
+      }\
+      elems[i] = elems[best];\
+      i = best;\
+    }\
+    elems[i] = elem;\
+  }\
+\
+  /* Restore the heap order of the first n elements bottom-up. */\
+  void RBD(Heap, _build)(Elem *elems, size_t n) {\
+    if (n < 2) {\
+      return;\
+    }\
+    for (size_t i = (n - 2) / RBD_IF(Arity)(Arity, RBD_HEAP_ARITY) + 1; i-- > 0;) {\
+      RBD(Heap, _siftDown)(elems, i, n, elems[i]);\
+    }\
+  }\
+\
+  Heap *RBD(Heap, _cons)(Heap *heap, size_t cap) {\
+    RBD(List, _cons)(&heap->list, cap);\
+    return heap;\
+  }\
+\
+  Heap *RBD(Heap, _heapify)(Heap *heap, List *list) {\
+    heap->list = *list;\
+    RBD(Heap, _build)(heap->list.elems, heap->list.len);\
+    return heap;\
+  }\
+\
+  bool RBD(Heap, _empty)(Heap *heap) {\
+    return !heap->list.len;\
+  }\
+\
+  size_t RBD(Heap, _len)(Heap *heap) {\
+    return heap->list.len;\
+  }\
+\
+  List *RBD(Heap, _list)(Heap *heap) {\
+    return &heap->list;\
+  }\
+\
+  Elem *RBD(Heap, _top)(Heap *heap) {\
+    return &heap->list.elems[0];\
+  }\
+\
+  void RBD(Heap, _push)(Heap *heap, Elem elem) {\
+    RBD(List, _pushBack)(&heap->list, elem);\
+    RBD(Heap, _siftUp)(heap->list.elems, heap->list.len - 1);\
+  }\
+\
+  void RBD(Heap, _pushN)(Heap *heap, Elem *elems, size_t n) {\
+    size_t len = heap->list.len;\
+    RBD(List, _reserve)(&heap->list, len + n);\
+    for (size_t i = 0; i < n; i++) {\
+      heap->list.elems[len + i] = elems[i];\
+    }\
+    heap->list.len = len + n;\
+    if (n > len) {\
+      RBD(Heap, _build)(heap->list.elems, heap->list.len);\
+      return;\
+    }\
+    for (size_t i = len; i < len + n; i++) {\
+      RBD(Heap, _siftUp)(heap->list.elems, i);\
+    }\
+  }\
+\
+  Elem RBD(Heap, _pop)(Heap *heap) {\
+    Elem *elems = heap->list.elems;\
+    Elem top = elems[0];\
+    size_t n = --heap->list.len;\
+    if (n) {\
+      RBD(Heap, _siftDown)(elems, 0, n, elems[n]);\
+    }\
+    return top;\
+  }\
+\
+  Elem RBD(Heap, _replace)(Heap *heap, Elem elem) {\
+    Elem top = heap->list.elems[0];\
+    RBD(Heap, _siftDown)(heap->list.elems, 0, heap->list.len, elem);\
+    return top;\
+  }\
+\
+  void RBD(Heap, _clear)(Heap *heap) {\
+    RBD(List, _clear)(&heap->list);\
+  }\
+\
+  void RBD(Heap, _debug)(Heap *heap, FILE *file, uint32_t depth) {\
+    fprintf(file, #Heap " (%p) {\n", heap);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "list: "); RBD(List, _debug)(&heap->list, file, depth + 1); fprintf(file, ",\n");\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  Heap *RBD(Heap, _des)(Heap *heap) {\
+    RBD(List, _des)(&heap->list);\
+    return heap;\
+  }
+
+// RBD_INDEXEDHEAP_GEN_DECL(Heap, Elem)
+
+/* Generate the declarations for the indexed heap. */
+#define RBD_INDEXEDHEAP_GEN_DECL(Heap, Elem)\
+\
+  /*=================================================================================================================*/\
+  /* Indexed Heap Node                                                                                               */\
+  /*=================================================================================================================*/\
+\
+  /* Indexed heap node. */\
+  typedef struct RBD(Heap, Node) RBD(Heap, Node);\
+\
+  /*=================================================================================================================*/\
+  /* Indexed Heap Storage                                                                                            */\
+  /*=================================================================================================================*/\
+\
+  RBD_LIST_GEN_DECL(RBD(Heap, List), RBD(Heap, Node))\
+\
+  /*=================================================================================================================*/\
+  /* Indexed Heap                                                                                                    */\
+  /*=================================================================================================================*/\
+\
+  /* Indexed heap. */\
+  typedef struct Heap Heap;\
+\
+  /* Construct a new indexed heap with initial capacity. */\
+  Heap *RBD(Heap, _cons)(Heap *heap, size_t cap);\
+\
+  /* Check if the indexed heap is empty. */\
+  bool RBD(Heap, _empty)(Heap *heap);\
+\
+  /* Get the length of the indexed heap. */\
+  size_t RBD(Heap, _len)(Heap *heap);\
+\
+  /* Check if the id is in the indexed heap. */\
+  bool RBD(Heap, _contains)(Heap *heap, size_t id);\
+\
+  /* Get the element of the id (must exist). */\
+  Elem *RBD(Heap, _at)(Heap *heap, size_t id);\
+\
+  /* Get the least element (heap must not be empty). */\
+  Elem *RBD(Heap, _top)(Heap *heap);\
+\
+  /* Get the id of the least element (heap must not be empty). */\
+  size_t RBD(Heap, _topId)(Heap *heap);\
+\
+  /* Push an element under the id (must not exist). Ids index a table, so they should be small and dense. */\
+  void RBD(Heap, _push)(Heap *heap, size_t id, Elem elem);\
+\
+  /* Pop the least element, storing its id if not null (heap must not be empty). */\
+  Elem RBD(Heap, _pop)(Heap *heap, size_t *id);\
+\
+  /* Lower the element of the id to the provided element, which must not be ordered after it (id must exist). */\
+  void RBD(Heap, _decreaseKey)(Heap *heap, size_t id, Elem elem);\
+\
+  /* Change the element of the id to the provided element in either direction (id must exist). */\
+  void RBD(Heap, _update)(Heap *heap, size_t id, Elem elem);\
+\
+  /* Erase the element of the id, returning it (id must exist). */\
+  Elem RBD(Heap, _erase)(Heap *heap, size_t id);\
+\
+  /* Clear all elements and set length to zero. */\
+  void RBD(Heap, _clear)(Heap *heap);\
+\
+  /* Print the underlying representation of the indexed heap, calling element debug for each element. */\
+  void RBD(Heap, _debug)(Heap *heap, FILE *file, uint32_t depth);\
+\
+  /* Destruct the indexed heap. */\
+  Heap *RBD(Heap, _des)(Heap *heap);
+
+// RBD_INDEXEDHEAP_GEN_DEF(Heap, Elem, /*&*/, /*Elem_compare*/, /*Elem_debug*/, /*Arity*/, /*Allocator_alloc*/, /*Allocator_realloc*/, /*Allocator_free*/)
+
+/* Generate the definitions for the indexed heap, a d-ary min-heap of elements addressed by id. Nodes pair each */
+/* element with its id, and a table maps every id to its node's position, so an element can be found, changed or */
+/* erased in logarithmic time. */
+#define RBD_INDEXEDHEAP_GEN_DEF(Heap, Elem, Elem_ref, Elem_compare, Elem_debug, Arity, Allocator_alloc, Allocator_realloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Indexed Heap Node                                                                                               */\
+  /*=================================================================================================================*/\
+\
+  struct RBD(Heap, Node) {\
+    Elem elem;\
+    size_t id;\
+  };\
+\
+  /* Check if two indexed heap nodes have the same id. */\
+  bool RBD(Heap, Node_equals)(RBD(Heap, Node) *a, RBD(Heap, Node) *b) {\
+    return a->id == b->id;\
+  }\
+\
+  /* Print the underlying representation of the indexed heap node with depth indentation. */\
+  void RBD(Heap, Node_debug)(RBD(Heap, Node) *node, FILE *file, RBD_UNUSED uint32_t depth) {\
+    fprintf(file, #Heap "Node { elem: "); RBD_IF(Elem_debug)(Elem_debug(Elem_ref(node->elem), file, depth), fprintf(file, #Heap "Elem { ? }")); fprintf(file, ", id: %lu }", node->id);\
+  }\
+\
+  /*=================================================================================================================*/\
+  /* Indexed Heap Storage                                                                                            */\
+  /*=================================================================================================================*/\
+\
+  RBD_LIST_GEN_DEF(RBD(Heap, List), RBD(Heap, Node), &, RBD(Heap, Node_equals), RBD(Heap, Node_debug), , Allocator_alloc, Allocator_realloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Indexed Heap                                                                                                    */\
+  /*=================================================================================================================*/\
+\
+  /* Positions map each id to the index of its node, or `RBD_HEAP_ABSENT` (printed as -1). */\
+  struct Heap {\
+    RBD(Heap, List) list;\
+    size_t *positions;\
+    size_t ids;\
+  };\
+\
+  /* Place the node at i, recording its position. */\
+  void RBD(Heap, _place)(Heap *heap, size_t i, RBD(Heap, Node) node) {\
+    heap->list.elems[i] = node;\
+    heap->positions[node.id] = i;\
+  }\
+\
+  /* Move the provided node up from i to its place. */\
+  void RBD(Heap, _siftUp)(Heap *heap, size_t i, RBD(Heap, Node) node) {\
+    RBD(Heap, Node) *nodes = heap->list.elems;\
+    while (i > 0) {\
+      size_t p = (i - 1) / RBD_IF(Arity)(Arity, RBD_HEAP_ARITY);\
+      if (!RBD_LIST_LESS(Elem_ref, Elem_compare, node.elem, nodes[p].elem)) {\
+        break;\
+      }\
+      RBD(Heap, _place)(heap, i, nodes[p]);\
+      i = p;\
+    }\
+    RBD(Heap, _place)(heap, i, node);\
+  }\
+\
+  /* Move the provided node down from i to its place. */\
+  void RBD(Heap, _siftDown)(Heap *heap, size_t i, RBD(Heap, Node) node) {\
+    RBD(Heap, Node) *nodes = heap->list.elems;\
+    size_t n = heap->list.len;\
+    for (;;) {\
+      size_t c = i * RBD_IF(Arity)(Arity, RBD_HEAP_ARITY) + 1;\
+      if (c >= n) {\
+        break;\
+      }\
+      size_t end = (n - c < RBD_IF(Arity)(Arity, RBD_HEAP_ARITY)) ? n : c + RBD_IF(Arity)(Arity, RBD_HEAP_ARITY), best = c;\
+      for (size_t k = c + 1; k < end; k++) {\
+        if (RBD_LIST_LESS(Elem_ref, Elem_compare, nodes[k].elem, nodes[best].elem)) {\
+          best = k;\
+        }\
+      }\
+      if (!RBD_LIST_LESS(Elem_ref, Elem_compare, nodes[best].elem, node.elem)) {\
+        break;\
+      }\
+      RBD(Heap, _place)(heap, i, nodes[best]);\
+      i = best;\
+    }\
+    RBD(Heap, _place)(heap, i, node);\
+  }\
+\
+  Heap *RBD(Heap, _cons)(Heap *heap, size_t cap) {\
+    RBD(Heap, List_cons)(&heap->list, cap);\
+    heap->positions = NULL;\
+    heap->ids = 0;\
+    return heap;\
+  }\
+\
+  bool RBD(Heap, _empty)(Heap *heap) {\
+    return !heap->list.len;\
+  }\
+\
+  size_t RBD(Heap, _len)(Heap *heap) {\
+    return heap->list.len;\
+  }\
+\
+  bool RBD(Heap, _contains)(Heap *heap, size_t id) {\
+    return id < heap->ids && heap->positions[id] != RBD_HEAP_ABSENT;\
+  }\
+\
+  Elem *RBD(Heap, _at)(Heap *heap, size_t id) {\
+    return &heap->list.elems[heap->positions[id]].elem;\
+  }\
+\
+  Elem *RBD(Heap, _top)(Heap *heap) {\
+    return &heap->list.elems[0].elem;\
+  }\
+\
+  size_t RBD(Heap, _topId)(Heap *heap) {\
+    return heap->list.elems[0].id;\
+  }\
+\
+  void RBD(Heap, _push)(Heap *heap, size_t id, Elem elem) {\
+    if (id >= heap->ids) {\
+      size_t ids = (id + 1 > heap->ids * 2) ? id + 1 : heap->ids * 2;\
+      heap->positions = RBD_IF(Allocator_realloc)(Allocator_realloc, realloc)(heap->positions, ids * sizeof(size_t));\
+      for (size_t i = heap->ids; i < ids; i++) {\
+        heap->positions[i] = RBD_HEAP_ABSENT;\
+      }\
+      heap->ids = ids;\
+    }\
+    RBD(Heap, List_emplaceBack)(&heap->list);\
+    RBD(Heap, _siftUp)(heap, heap->list.len - 1, (RBD(Heap, Node)) { .elem = elem, .id = id });\
+  }\
+\
+  Elem RBD(Heap, _erase)(Heap *heap, size_t id) {\
+    size_t i = heap->positions[id];\
+    Elem elem = heap->list.elems[i].elem;\
+    heap->positions[id] = RBD_HEAP_ABSENT;\
+    RBD(Heap, Node) last = heap->list.elems[--heap->list.len];\
+    if (i < heap->list.len) {\
+      if (i > 0 && RBD_LIST_LESS(Elem_ref, Elem_compare, last.elem, heap->list.elems[(i - 1) / RBD_IF(Arity)(Arity, RBD_HEAP_ARITY)].elem)) {\
+        RBD(Heap, _siftUp)(heap, i, last);\
+      } else {\
+        RBD(Heap, _siftDown)(heap, i, last);\
+      }\
+    }\
+    return elem;\
+  }\
+\
+  Elem RBD(Heap, _pop)(Heap *heap, size_t *id) {\
+    if (id) {\
+      *id = heap->list.elems[0].id;\
+    }\
+    return RBD(Heap, _erase)(heap, heap->list.elems[0].id);\
+  }\
+\
+  void RBD(Heap, _decreaseKey)(Heap *heap, size_t id, Elem elem) {\
+    RBD(Heap, _siftUp)(heap, heap->positions[id], (RBD(Heap, Node)) { .elem = elem, .id = id });\
+  }\
+\
+  void RBD(Heap, _update)(Heap *heap, size_t id, Elem elem) {\
+    size_t i = heap->positions[id];\
+    RBD(Heap, Node) node = { .elem = elem, .id = id };\
+    if (RBD_LIST_LESS(Elem_ref, Elem_compare, elem, heap->list.elems[i].elem)) {\
+      RBD(Heap, _siftUp)(heap, i, node);\
+    } else {\
+      RBD(Heap, _siftDown)(heap, i, node);\
+    }\
+  }\
+\
+  void RBD(Heap, _clear)(Heap *heap) {\
+    for (size_t i = 0; i < heap->list.len; i++) {\
+      heap->positions[heap->list.elems[i].id] = RBD_HEAP_ABSENT;\
+    }\
+    RBD(Heap, List_clear)(&heap->list);\
+  }\
+\
+  void RBD(Heap, _debug)(Heap *heap, FILE *file, uint32_t depth) {\
+    fprintf(file, #Heap " (%p) {\n", heap);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "list: "); RBD(Heap, List_debug)(&heap->list, file, depth + 1); fprintf(file, ",\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "positions: (%p) [", heap->positions);\
+    for (size_t i = 0; i < heap->ids; i++) {\
+      fprintf(file, i ? ", %ld" : "%ld", (long)heap->positions[i]);\
+    }\
+    fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "ids: %lu,\n", heap->ids);\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  Heap *RBD(Heap, _des)(Heap *heap) {\
+    RBD(Heap, List_des)(&heap->list);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(heap->positions);\
+    return heap;\
+  }
+
+#endif // RBD_HEAP_H
@@ -8,9 +8,18 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 
 #include "rbddef.h"
 
+/* Number of elements compared per branch in the scanning kernels. Blocks are evaluated without early exit so they */
+/* vectorize for arithmetic element types. */
+#define RBD_LIST_SCAN_BLOCK 16
+
+/* Check if two elements are equal, calling element equals, if necessary. */
+#define RBD_LIST_EQUALS(Elem_ref, Elem_equals, a, b) RBD_IF(Elem_equals)(Elem_equals(Elem_ref(a), Elem_ref(b)), ((a) == (b)))
+
 // RBD_LIST_GEN_DECL(List, Elem);
 
 /* Generate the declarations for the list. */
@@ -95,12 +104,25 @@
 \
   /* Erase the provided element, calling element destructor. */\
   void RBD(List, _erase)(List *list, size_t i);\
+\
+  /* Keep only the elements matching the predicate in one pass, calling element destructor for the rest. Returns the */\
+  /* number erased. */\
+  size_t RBD(List, _retain)(List *list, bool (*pred)(Elem *elem, void *ctx), void *ctx);\
+\
+  /* Erase the elements matching the predicate in one pass, calling element destructor. Returns the number erased. */\
+  size_t RBD(List, _removeIf)(List *list, bool (*pred)(Elem *elem, void *ctx), void *ctx);\
 \
   /* Return iterator starting at first element. */\
   RBD(List, Iter) RBD(List, _begin)(List *list);\
 \
   /* Return iterator starting after last element. */\
   RBD(List, Iter) RBD(List, _end)(List *list);\
+\
+  /* Return iterator at the first element equal to the provided element, or the end if none is. */\
+  RBD(List, Iter) RBD(List, _find)(List *list, Elem elem);\
+\
+  /* Count the elements equal to the provided element. */\
+  size_t RBD(List, _count)(List *list, Elem elem);\
 \
   /* Checks if two lists are equal, calling element equals for each element, if necessary. */\
   bool RBD(List, _equals)(List *a, List *b);\
@@ -267,6 +289,29 @@
     }\
     --list->len;\
   }\
+\
+  /* Compact the elements whose predicate result equals keep to the front, destructing the others. */\
+  size_t RBD(List, _filter)(List *list, bool (*pred)(Elem *elem, void *ctx), void *ctx, bool keep) {\
+    size_t j = 0;\
+    for (size_t i = 0; i < list->len; i++) {\
+      if (pred(&list->elems[i], ctx) == keep) {\
+        list->elems[j++] = list->elems[i];\
+      } else {\
+        RBD_IF(Elem_des)(Elem_des(Elem_ref(list->elems[i])),);\
+      }\
+    }\
+    size_t n = list->len - j;\
+    list->len = j;\
+    return n;\
+  }\
+\
+  size_t RBD(List, _retain)(List *list, bool (*pred)(Elem *elem, void *ctx), void *ctx) {\
+    return RBD(List, _filter)(list, pred, ctx, true);\
+  }\
+\
+  size_t RBD(List, _removeIf)(List *list, bool (*pred)(Elem *elem, void *ctx), void *ctx) {\
+    return RBD(List, _filter)(list, pred, ctx, false);\
+  }\
 \
   RBD(List, Iter) RBD(List, _begin)(List *list) {\
     return RBD(List, Iter_cons)(&list->elems[0]);\
@@ -275,13 +320,54 @@
   RBD(List, Iter) RBD(List, _end)(List *list) {\
     return RBD(List, Iter_cons)(&list->elems[list->len]);\
   }\
+\
+  RBD(List, Iter) RBD(List, _find)(List *list, Elem elem) {\
+    size_t i = 0;\
+    if (!RBD_IF(Elem_equals)(true, false)) {\
+      for (; i + RBD_LIST_SCAN_BLOCK <= list->len; i += RBD_LIST_SCAN_BLOCK) {\
+        bool found = false;\
+        for (size_t j = i; j < i + RBD_LIST_SCAN_BLOCK; j++) {\
+          found |= RBD_LIST_EQUALS(Elem_ref, Elem_equals, list->elems[j], elem);\
+        }\
+        if (found) {\
+          break;\
+        }\
+      }\
+    }\
+    for (; i < list->len; i++) {\
+      if (RBD_LIST_EQUALS(Elem_ref, Elem_equals, list->elems[i], elem)) {\
+        break;\
+      }\
+    }\
+    return RBD(List, Iter_cons)(&list->elems[i]);\
+  }\
+\
+  size_t RBD(List, _count)(List *list, Elem elem) {\
+    size_t count = 0;\
+    for (size_t i = 0; i < list->len; i++) {\
+      count += RBD_LIST_EQUALS(Elem_ref, Elem_equals, list->elems[i], elem);\
+    }\
+    return count;\
+  }\
 \
   bool RBD(List, _equals)(List *a, List *b) {\
     if (a->len != b->len) {\
       return false;\
     }\
-    for (size_t i = 0; i < a->len; i++) {\
-      if (!RBD_IF(Elem_equals)(Elem_equals(Elem_ref(a->elems[i]), Elem_ref(b->elems[i])), (a->elems[i] == b->elems[i]))) {\
+    size_t i = 0;\
+    if (!RBD_IF(Elem_equals)(true, false)) {\
+      for (; i + RBD_LIST_SCAN_BLOCK <= a->len; i += RBD_LIST_SCAN_BLOCK) {\
+        bool equal = true;\
+        for (size_t j = i; j < i + RBD_LIST_SCAN_BLOCK; j++) {\
+          equal &= RBD_LIST_EQUALS(Elem_ref, Elem_equals, a->elems[j], b->elems[j]);\
+        }\
+        if (!equal) {\
+          return false;\
+        }\
+      }\
+    }\
+    for (; i < a->len; i++) {\
+      if (!RBD_LIST_EQUALS(Elem_ref, Elem_equals, a->elems[i], b->elems[i])) {\
         return false;\
       }\
     }\
@@ -308,4 +394,378 @@
     return list;\
   }
 
+/* Check if the first element is ordered before the second, calling element compare, if necessary. */
+#define RBD_LIST_LESS(Elem_ref, Elem_compare, a, b) RBD_IF(Elem_compare)((Elem_compare(Elem_ref(a), Elem_ref(b)) < 0), ((a) < (b)))
+
+/* Partition length at or below which introsort hands off to insertion sort. */
+#define RBD_LIST_SORT_INSERTION 16
+
+/* Swap two elements. */
+#define RBD_LIST_SWAP(Elem, a, b)\
+  do {\
+    Elem _swap = (a);\
+    (a) = (b);\
+    (b) = _swap;\
+  } while (0)
+
+// RBD_LIST_SORT_GEN_DECL(List, Elem);
+
+/* Generate the declarations for the list sorting and searching kernels. */
+#define RBD_LIST_SORT_GEN_DECL(List, Elem)\
+\
+  /*=================================================================================================================*/\
+  /* List Sort                                                                                                       */\
+  /*=================================================================================================================*/\
+\
+  /* Sort the list in ascending order (not stable). */\
+  void RBD(List, _sort)(List *list);\
+\
+  /* Check if the list is sorted in ascending order. */\
+  bool RBD(List, _isSorted)(List *list);\
+\
+  /* Get the index of the first element not ordered before the provided element (list must be sorted). */\
+  size_t RBD(List, _lowerBound)(List *list, Elem elem);\
+\
+  /* Get the index of the first element ordered after the provided element (list must be sorted). */\
+  size_t RBD(List, _upperBound)(List *list, Elem elem);\
+\
+  /* Return iterator at an element equivalent to the provided element, or the end if none is (list must be sorted). */\
+  RBD(List, Iter) RBD(List, _binarySearch)(List *list, Elem elem);
+
+// RBD_LIST_SORT_GEN_DEF(List, Elem, /*&*/, /*Elem_compare*/);
+
+/* Generate the definitions for the list sorting and searching kernels. */
+#define RBD_LIST_SORT_GEN_DEF(List, Elem, Elem_ref, Elem_compare)\
+\
+  /*=================================================================================================================*/\
+  /* List Sort                                                                                                       */\
+  /*=================================================================================================================*/\
+\
+  /* Sort the elements with insertion sort. */\
+  void RBD(List, _sortInsertion)(Elem *elems, size_t n) {\
+    for (size_t i = 1; i < n; i++) {\
+      Elem elem = elems[i];\
+      size_t j = i;\
+      for (; j > 0 && RBD_LIST_LESS(Elem_ref, Elem_compare, elem, elems[j - 1]); j--) {\
+        elems[j] = elems[j - 1];\
+      }\
+      elems[j] = elem;\
+    }\
+  }\
+\
+  /* Sift the element at the index down the max-heap of n elements. */\
+  void RBD(List, _sortSift)(Elem *elems, size_t i, size_t n) {\
+    Elem elem = elems[i];\
+    for (size_t j = 2 * i + 1; j < n; j = 2 * i + 1) {\
+      if (j + 1 < n && RBD_LIST_LESS(Elem_ref, Elem_compare, elems[j], elems[j + 1])) {\
+        j++;\
+      }\
+      if (!RBD_LIST_LESS(Elem_ref, Elem_compare, elem, elems[j])) {\
+        break;\
+      }\
+      elems[i] = elems[j];\
+      i = j;\
+    }\
+    elems[i] = elem;\
+  }\
+\
+  /* Sort the elements with heap sort. */\
+  void RBD(List, _sortHeap)(Elem *elems, size_t n) {\
+    for (size_t i = n / 2; i > 0; i--) {\
+      RBD(List, _sortSift)(elems, i - 1, n);\
+    }\
+    for (size_t i = n - 1; i > 0; i--) {\
+      RBD_LIST_SWAP(Elem, elems[0], elems[i]);\
+      RBD(List, _sortSift)(elems, 0, i);\
+    }\
+  }\
+\
+  /* Sort the elements with introsort, falling back to heap sort once the depth budget is exhausted. */\
+  void RBD(List, _sortIntro)(Elem *elems, size_t n, size_t depth) {\
+    while (n > RBD_LIST_SORT_INSERTION) {\
+      if (!depth--) {\
+        RBD(List, _sortHeap)(elems, n);\
+        return;\
+      }\
+      size_t mid = n / 2;\
+      if (RBD_LIST_LESS(Elem_ref, Elem_compare, elems[mid], elems[0])) {\
+        RBD_LIST_SWAP(Elem, elems[mid], elems[0]);\
+      }\
+      if (RBD_LIST_LESS(Elem_ref, Elem_compare, elems[n - 1], elems[mid])) {\
+        RBD_LIST_SWAP(Elem, elems[n - 1], elems[mid]);\
+        if (RBD_LIST_LESS(Elem_ref, Elem_compare, elems[mid], elems[0])) {\
+          RBD_LIST_SWAP(Elem, elems[mid], elems[0]);\
+        }\
+      }\
+      Elem pivot = elems[mid];\
+      size_t i = 0, j = n - 1;\
+      for (;;) {\
+        while (RBD_LIST_LESS(Elem_ref, Elem_compare, elems[i], pivot)) {\
+          i++;\
+        }\
+        while (RBD_LIST_LESS(Elem_ref, Elem_compare, pivot, elems[j])) {\
+          j--;\
+        }\
+        if (i >= j) {\
+          break;\
+        }\
+        RBD_LIST_SWAP(Elem, elems[i], elems[j]);\
+        i++;\
+        j--;\
+      }\
+      size_t split = j + 1;\
+      if (split < n - split) {\
+        RBD(List, _sortIntro)(elems, split, depth);\
+        elems += split;\
+        n -= split;\
+      } else {\
+        RBD(List, _sortIntro)(elems + split, n - split, depth);\
+        n = split;\
+      }\
+    }\
+    RBD(List, _sortInsertion)(elems, n);\
+  }\
+\
+  void RBD(List, _sort)(List *list) {\
+    if (list->len > 1) {\
+      RBD(List, _sortIntro)(list->elems, list->len, 2 * (8 * sizeof(unsigned long long) - __builtin_clzll(list->len)));\
+    }\
+  }\
+\
+  bool RBD(List, _isSorted)(List *list) {\
+    for (size_t i = 1; i < list->len; i++) {\
+      if (RBD_LIST_LESS(Elem_ref, Elem_compare, list->elems[i], list->elems[i - 1])) {\
+        return false;\
+      }\
+    }\
+    return true;\
+  }\
+\
+  size_t RBD(List, _lowerBound)(List *list, Elem elem) {\
+    size_t lo = 0, n = list->len;\
+    while (n > 0) {\
+      size_t half = n / 2;\
+      bool before = RBD_LIST_LESS(Elem_ref, Elem_compare, list->elems[lo + half], elem);\
+      lo = before ? lo + half + 1 : lo;\
+      n = before ? n - half - 1 : half;\
+    }\
+    return lo;\
+  }\
+\
+  size_t RBD(List, _upperBound)(List *list, Elem elem) {\
+    size_t lo = 0, n = list->len;\
+    while (n > 0) {\
+      size_t half = n / 2;\
+      bool before = !RBD_LIST_LESS(Elem_ref, Elem_compare, elem, list->elems[lo + half]);\
+      lo = before ? lo + half + 1 : lo;\
+      n = before ? n - half - 1 : half;\
+    }\
+    return lo;\
+  }\
+\
+  RBD(List, Iter) RBD(List, _binarySearch)(List *list, Elem elem) {\
+    size_t i = RBD(List, _lowerBound)(list, elem);\
+    if (i < list->len && !RBD_LIST_LESS(Elem_ref, Elem_compare, elem, list->elems[i])) {\
+      return RBD(List, Iter_cons)(&list->elems[i]);\
+    }\
+    return RBD(List, Iter_cons)(&list->elems[list->len]);\
+  }
+
+// RBD_LIST_RADIX_GEN_DECL(List, Elem);
+
+/* Generate the declarations for the list radix sort. */
+#define RBD_LIST_RADIX_GEN_DECL(List, Elem)\
+\
+  /*=================================================================================================================*/\
+  /* List Radix Sort                                                                                                 */\
+  /*=================================================================================================================*/\
+\
+  /* Sort the list in ascending order of element keys with a stable LSD radix sort. */\
+  void RBD(List, _radixSort)(List *list);
+
+// RBD_LIST_RADIX_GEN_DEF(List, Elem, /*&*/, /*Elem_key*/, /*Allocator_alloc*/, /*Allocator_free*/);
+
+/* Generate the definitions for the list radix sort. `Elem_key` maps an element to a `uint64_t` whose unsigned order */
+/* is the sort order, defaulting to a cast of the element. The default orders negative signed integers after the */
+/* positive ones; for signed keys pass an `Elem_key` that flips the sign bit, e.g. `(uint64_t)x ^ (1ULL << 63)`. */
+#define RBD_LIST_RADIX_GEN_DEF(List, Elem, Elem_ref, Elem_key, Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* List Radix Sort                                                                                                 */\
+  /*=================================================================================================================*/\
+\
+  void RBD(List, _radixSort)(List *list) {\
+    size_t counts[8][256] = {{0}};\
+    for (size_t i = 0; i < list->len; i++) {\
+      uint64_t key = RBD_IF(Elem_key)(Elem_key(Elem_ref(list->elems[i])), (uint64_t)list->elems[i]);\
+      for (size_t d = 0; d < 8; d++) {\
+        counts[d][(key >> (8 * d)) & 0xff]++;\
+      }\
+    }\
+    Elem *src = list->elems;\
+    Elem *dst = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(list->len * sizeof(Elem));\
+    for (size_t d = 0; d < 8; d++) {\
+      size_t offs[256], sum = 0;\
+      bool trivial = false;\
+      for (size_t b = 0; b < 256; b++) {\
+        trivial |= (counts[d][b] == list->len);\
+        offs[b] = sum;\
+        sum += counts[d][b];\
+      }\
+      if (trivial) {\
+        continue;\
+      }\
+      for (size_t i = 0; i < list->len; i++) {\
+        uint64_t key = RBD_IF(Elem_key)(Elem_key(Elem_ref(src[i])), (uint64_t)src[i]);\
+        dst[offs[(key >> (8 * d)) & 0xff]++] = src[i];\
+      }\
+      Elem *tmp = src;\
+      src = dst;\
+      dst = tmp;\
+    }\
+    if (src != list->elems) {\
+      memcpy(list->elems, src, list->len * sizeof(Elem));\
+      dst = src;\
+    }\
+    RBD_IF(Allocator_free)(Allocator_free, free)(dst);\
+  }
+
+/* Minimum number of elements per thread in the parallel sort. */
+#define RBD_LIST_PARSORT_MIN_CHUNK ((size_t)1 << 16)
+
+// RBD_LIST_PARSORT_GEN_DECL(List, Elem);
+
+/* Generate the declarations for the list parallel sort. */
+#define RBD_LIST_PARSORT_GEN_DECL(List, Elem)\
+\
+  /*=================================================================================================================*/\
+  /* List Parallel Sort                                                                                              */\
+  /*=================================================================================================================*/\
+\
+  /* Sort the list in ascending order on up to the provided number of threads, including the caller (not stable). */\
+  void RBD(List, _sortParallel)(List *list, size_t threads);
+
+// RBD_LIST_PARSORT_GEN_DEF(List, Elem, /*&*/, /*Elem_compare*/, /*Allocator_alloc*/, /*Allocator_free*/);
+
+/* Generate the definitions for the list parallel sort, which uses the introsort of `RBD_LIST_SORT_GEN_DEF` for the */
+/* same list. Chunks of at least `RBD_LIST_PARSORT_MIN_CHUNK` elements are sorted on their own threads, then merged */
+/* pairwise through a scratch buffer, one thread per merge. Threads that cannot be created run on the caller. */
+#define RBD_LIST_PARSORT_GEN_DEF(List, Elem, Elem_ref, Elem_compare, Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* List Parallel Sort Task                                                                                         */\
+  /*=================================================================================================================*/\
+\
+  /* List parallel sort task. */\
+  typedef struct RBD(List, SortTask) RBD(List, SortTask);\
+\
+  /* Sorts src[lo, hi), or merges the sorted runs src[lo, mid) and src[mid, hi) into dst[lo, hi). */\
+  struct RBD(List, SortTask) {\
+    Elem *src;\
+    Elem *dst;\
+    size_t lo;\
+    size_t mid;\
+    size_t hi;\
+  };\
+\
+  /* Sort the chunk of the task. */\
+  void *RBD(List, SortTask_sort)(void *arg) {\
+    RBD(List, SortTask) *task = arg;\
+    size_t n = task->hi - task->lo;\
+    if (n > 1) {\
+      RBD(List, _sortIntro)(task->src + task->lo, n, 2 * (8 * sizeof(unsigned long long) - __builtin_clzll(n)));\
+    }\
+    return NULL;\
+  }\
+\
+  /* Merge the runs of the task. */\
+  void *RBD(List, SortTask_merge)(void *arg) {\
+    RBD(List, SortTask) *task = arg;\
+    Elem *src = task->src, *dst = task->dst;\
+    size_t i = task->lo, j = task->mid, k = task->lo;\
+    while (i < task->mid && j < task->hi) {\
+      dst[k++] = RBD_LIST_LESS(Elem_ref, Elem_compare, src[j], src[i]) ? src[j++] : src[i++];\
+    }\
+    memcpy(&dst[k], &src[i], (task->mid - i) * sizeof(Elem));\
+    k += task->mid - i;\
+    memcpy(&dst[k], &src[j], (task->hi - j) * sizeof(Elem));\
+    return NULL;\
+  }\
+\
+  /*=================================================================================================================*/\
+  /* List Parallel Sort                                                                                              */\
+  /*=================================================================================================================*/\
+\
+  /* Run the tasks, one per thread, with the first on the calling thread. */\
+  void RBD(List, _sortRun)(void *(*run)(void *), RBD(List, SortTask) *tasks, pthread_t *threads, bool *started, size_t n) {\
+    for (size_t i = 1; i < n; i++) {\
+      started[i] = !pthread_create(&threads[i], NULL, run, &tasks[i]);\
+    }\
+    run(&tasks[0]);\
+    for (size_t i = 1; i < n; i++) {\
+      if (started[i]) {\
+        pthread_join(threads[i], NULL);\
+      } else {\
+        run(&tasks[i]);\
+      }\
+    }\
+  }\
+\
+  void RBD(List, _sortParallel)(List *list, size_t threads) {\
+    size_t n = list->len;\
+    if (threads > n / RBD_LIST_PARSORT_MIN_CHUNK) {\
+      threads = n / RBD_LIST_PARSORT_MIN_CHUNK;\
+    }\
+    if (threads < 2) {\
+      RBD(List, _sort)(list);\
+      return;\
+    }\
+    RBD(List, SortTask) *tasks = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(threads * sizeof(RBD(List, SortTask)));\
+    pthread_t *ids = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(threads * sizeof(pthread_t));\
+    bool *started = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(threads * sizeof(bool));\
+    size_t *bounds = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)((threads + 1) * sizeof(size_t));\
+    Elem *src = list->elems;\
+    Elem *dst = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(n * sizeof(Elem));\
+    for (size_t i = 0; i <= threads; i++) {\
+      bounds[i] = n / threads * i + (n % threads) * i / threads;\
+    }\
+    for (size_t i = 0; i < threads; i++) {\
+      tasks[i] = (RBD(List, SortTask)) {\
+        .src = src,\
+        .lo = bounds[i],\
+        .hi = bounds[i + 1],\
+      };\
+    }\
+    RBD(List, _sortRun)(RBD(List, SortTask_sort), tasks, ids, started, threads);\
+    for (size_t runs = threads; runs > 1; runs = (runs + 1) / 2) {\
+      size_t m = 0;\
+      for (size_t r = 0; r < runs; r += 2) {\
+        tasks[m++] = (RBD(List, SortTask)) {\
+          .src = src,\
+          .dst = dst,\
+          .lo = bounds[r],\
+          .mid = bounds[r + 1],\
+          .hi = bounds[r + 1 < runs ? r + 2 : r + 1],\
+        };\
+      }\
+      RBD(List, _sortRun)(RBD(List, SortTask_merge), tasks, ids, started, m);\
+      for (size_t r = 0; r < m; r++) {\
+        bounds[r] = bounds[2 * r];\
+      }\
+      bounds[m] = n;\
+      Elem *tmp = src;\
+      src = dst;\
+      dst = tmp;\
+    }\
+    if (src != list->elems) {\
+      memcpy(list->elems, src, n * sizeof(Elem));\
+      dst = src;\
+    }\
+    RBD_IF(Allocator_free)(Allocator_free, free)(dst);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(bounds);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(started);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(ids);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(tasks);\
+  }
+
 #endif // RBD_LIST_H
@@ -8,12 +8,14 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "rbddef.h"
 
 #define RBD_MAP_ELEM_UNUSED 0
 #define RBD_MAP_ELEM_OCCUPIED 1
 #define RBD_MAP_ELEM_ERASED 2
+#define RBD_MAP_ELEM_MOVING 3
 
 // RBD_MAP_GEN_DECL(Map, Key, Val)
 
@@ -102,6 +104,17 @@
 \
   /* Erase the provided element (must exist). */\
   void RBD(Map, _erase)(Map *map, Key key);\
+\
+  /* Erase the element at the iterator, returning an iterator to the next element. */\
+  RBD(Map, Iter) RBD(Map, _eraseIter)(Map *map, RBD(Map, Iter) iter);\
+\
+  /* Keep only the elements matching the predicate in one table sweep, calling element destructor for the rest. */\
+  /* Returns the number erased. */\
+  size_t RBD(Map, _retain)(Map *map, bool (*pred)(Key *key, Val *val, void *ctx), void *ctx);\
+\
+  /* Erase the elements matching the predicate in one table sweep, calling element destructor. Returns the number */\
+  /* erased. */\
+  size_t RBD(Map, _removeIf)(Map *map, bool (*pred)(Key *key, Val *val, void *ctx), void *ctx);\
 \
   /* Return iterator starting at first element. */\
   RBD(Map, Iter) RBD(Map, _begin)(Map *map);\
@@ -256,10 +269,12 @@
   /* Map                                                                                                             */\
   /*=================================================================================================================*/\
 \
+  /* Erased elements are counted so that tombstones left by churn still trigger a rehash. */\
   struct Map {\
     RBD(Map, Elem) *elems;\
     size_t cap;\
     size_t len;\
+    size_t erased;\
   };\
 \
   Map *RBD(Map, _cons)(Map *map, size_t cap) {\
@@ -267,6 +282,7 @@
       .elems = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)((cap + 1) * sizeof(RBD(Map, Elem))),\
       .cap = cap,\
       .len = 0,\
+      .erased = 0,\
     };\
     memset(map->elems, 0, cap * sizeof(RBD(Map, Elem)));\
     map->elems[cap].typ = RBD_MAP_ELEM_OCCUPIED;\
@@ -303,6 +319,7 @@
     RBD_IF(Allocator_free)(Allocator_free, free)(map->elems);\
     map->elems = elems;\
     map->cap = cap;\
+    map->erased = 0;\
   }\
 \
   void RBD(Map, _reserve)(Map *map, size_t cap) {\
@@ -310,6 +327,48 @@
       RBD(Map, _reserveUnchecked)(map, cap);\
     }\
   }\
+\
+  /* Rehash in place at the same capacity to drop erased elements, without allocating. Occupied elements are marked */\
+  /* moving, then each is placed at the first slot of its probe sequence not yet holding a placed element, swapping */\
+  /* with the moving element found there, if any, and placing that one next. */\
+  void RBD(Map, _rehash)(Map *map) {\
+    for (size_t i = 0; i < map->cap; i++) {\
+      map->elems[i].typ = map->elems[i].typ == RBD_MAP_ELEM_OCCUPIED ? RBD_MAP_ELEM_MOVING : RBD_MAP_ELEM_UNUSED;\
+    }\
+    for (size_t i = 0; i < map->cap; i++) {\
+      while (map->elems[i].typ == RBD_MAP_ELEM_MOVING) {\
+        size_t j = map->elems[i].hash % map->cap;\
+        while (j != i && map->elems[j].typ == RBD_MAP_ELEM_OCCUPIED) {\
+          j = (j + 1) % map->cap;\
+        }\
+        if (j == i) {\
+          map->elems[i].typ = RBD_MAP_ELEM_OCCUPIED;\
+        } else if (map->elems[j].typ == RBD_MAP_ELEM_UNUSED) {\
+          map->elems[j] = map->elems[i];\
+          map->elems[j].typ = RBD_MAP_ELEM_OCCUPIED;\
+          RBD(Map, Elem_consUnused)(&map->elems[i]);\
+        } else {\
+          RBD(Map, Elem) elem = map->elems[j];\
+          map->elems[j] = map->elems[i];\
+          map->elems[j].typ = RBD_MAP_ELEM_OCCUPIED;\
+          map->elems[i] = elem;\
+        }\
+      }\
+    }\
+    map->erased = 0;\
+  }\
+\
+  /* Make room for one more element once occupied and erased elements fill two thirds of the table, doubling the */\
+  /* capacity if live elements fill a third of it and otherwise rehashing in place to drop tombstones. */\
+  void RBD(Map, _grow)(Map *map) {\
+    if (3 * (map->len + map->erased) > 2 * map->cap) {\
+      if (3 * map->len > map->cap) {\
+        RBD(Map, _reserveUnchecked)(map, map->cap * 2);\
+      } else {\
+        RBD(Map, _rehash)(map);\
+      }\
+    }\
+  }\
 \
   void RBD(Map, _clear)(Map *map) {\
     for (size_t i = 0; i < map->cap; i++) {\
@@ -317,15 +376,15 @@
       RBD(Map, Elem_consUnused)(&map->elems[i]);\
     }\
     map->len = 0;\
+    map->erased = 0;\
   }\
 \
   void RBD(Map, _insert)(Map *map, Key key, Val val) {\
-    if (3 * map->len > 2 * map->cap) {\
-      RBD(Map, _reserveUnchecked)(map, map->cap * 2);\
-    }\
+    RBD(Map, _grow)(map);\
     size_t hash = RBD_IF(Key_hash)(Key_hash(key), (size_t)key);\
     for (size_t i = hash % map->cap; ; i = (i + 1) % map->cap) {\
       if (map->elems[i].typ != RBD_MAP_ELEM_OCCUPIED) {\
+        map->erased -= map->elems[i].typ == RBD_MAP_ELEM_ERASED;\
         RBD(Map, Elem_consOccupied)(&map->elems[i], hash, key, val);\
         map->len++;\
         return;\
@@ -335,12 +394,11 @@
   }\
 \
   Val *RBD(Map, _emplace)(Map *map, Key key) {\
-    if (3 * map->len > 2 * map->cap) {\
-      RBD(Map, _reserveUnchecked)(map, map->cap * 2);\
-    }\
+    RBD(Map, _grow)(map);\
     size_t hash = RBD_IF(Key_hash)(Key_hash(key), (size_t)key);\
     for (size_t i = hash % map->cap; ; i = (i + 1) % map->cap) {\
       if (map->elems[i].typ != RBD_MAP_ELEM_OCCUPIED) {\
+        map->erased -= map->elems[i].typ == RBD_MAP_ELEM_ERASED;\
         map->elems[i] = (RBD(Map, Elem)) {\
           .typ = RBD_MAP_ELEM_OCCUPIED,\
           .hash = hash,\
@@ -409,18 +467,72 @@
     }\
     return false;\
   }\
+\
+  /* Turn erased elements preceding an unused element back into unused elements, walking backward from the index. */\
+  void RBD(Map, _reclaim)(Map *map, size_t i) {\
+    if (map->elems[(i + 1) % map->cap].typ != RBD_MAP_ELEM_UNUSED) {\
+      return;\
+    }\
+    while (map->elems[i].typ == RBD_MAP_ELEM_ERASED) {\
+      RBD(Map, Elem_consUnused)(&map->elems[i]);\
+      map->erased--;\
+      i = (i + map->cap - 1) % map->cap;\
+    }\
+  }\
+\
+  /* Erase the occupied element at the index. */\
+  void RBD(Map, _eraseAt)(Map *map, size_t i) {\
+    RBD(Map, Elem_des)(&map->elems[i]);\
+    RBD(Map, Elem_consErased)(&map->elems[i]);\
+    map->len--;\
+    map->erased++;\
+    RBD(Map, _reclaim)(map, i);\
+  }\
 \
   void RBD(Map, _erase)(Map *map, Key key) {\
     size_t hash = RBD_IF(Key_hash)(Key_hash(key), (size_t)key);\
     for (size_t i = hash % map->cap; ; i = (i + 1) % map->cap) {\
       if (map->elems[i].typ == RBD_MAP_ELEM_OCCUPIED && RBD_IF(Key_equals)(Key_equals(map->elems[i].key, key), map->elems[i].key == key)) {\
-        RBD(Map, Elem_des)(&map->elems[i]);\
-        RBD(Map, Elem_consErased)(&map->elems[i]);\
+        RBD(Map, _eraseAt)(map, i);\
         return;\
       }\
     }\
     __builtin_unreachable();\
   }\
+\
+  RBD(Map, Iter) RBD(Map, _eraseIter)(Map *map, RBD(Map, Iter) iter) {\
+    RBD(Map, _eraseAt)(map, iter.elem - map->elems);\
+    return RBD(Map, Iter_next)(iter);\
+  }\
+\
+  /* Erase the elements whose predicate result differs from keep, sweeping backward so that erased elements can be */\
+  /* reclaimed in the same pass. */\
+  size_t RBD(Map, _filter)(Map *map, bool (*pred)(Key *key, Val *val, void *ctx), void *ctx, bool keep) {\
+    size_t n = 0;\
+    for (size_t i = map->cap; i-- > 0;) {\
+      RBD(Map, Elem) *elem = &map->elems[i];\
+      if (elem->typ == RBD_MAP_ELEM_OCCUPIED && pred(&elem->key, &elem->val, ctx) != keep) {\
+        RBD(Map, Elem_des)(elem);\
+        RBD(Map, Elem_consErased)(elem);\
+        map->erased++;\
+        n++;\
+      }\
+      if (elem->typ == RBD_MAP_ELEM_ERASED && map->elems[(i + 1) % map->cap].typ == RBD_MAP_ELEM_UNUSED) {\
+        RBD(Map, Elem_consUnused)(elem);\
+        map->erased--;\
+      }\
+    }\
+    map->len -= n;\
+    return n;\
+  }\
+\
+  size_t RBD(Map, _retain)(Map *map, bool (*pred)(Key *key, Val *val, void *ctx), void *ctx) {\
+    return RBD(Map, _filter)(map, pred, ctx, true);\
+  }\
+\
+  size_t RBD(Map, _removeIf)(Map *map, bool (*pred)(Key *key, Val *val, void *ctx), void *ctx) {\
+    return RBD(Map, _filter)(map, pred, ctx, false);\
+  }\
 \
   RBD(Map, Iter) RBD(Map, _begin)(Map *map) {\
     RBD(Map, Elem) *elem = map->elems;\
@@ -460,6 +572,7 @@
     RBD_INDENT(file, depth + 1); fprintf(file, "],\n");\
     RBD_INDENT(file, depth + 1); fprintf(file, "cap: %lu,\n", map->cap);\
     RBD_INDENT(file, depth + 1); fprintf(file, "len: %lu,\n", map->len);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "erased: %lu,\n", map->erased);\
     RBD_INDENT(file, depth); fprintf(file, "}");\
   }\
 \
@@ -0,0 +1,301 @@
+// vim: ft=c
+
+#ifndef RBD_NUMA_H
+#define RBD_NUMA_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "rbddef.h"
+#include "rbdmap.h"
+
+/* Memory policies, matching the kernel's MPOL_* values. */
+#define RBD_NUMA_PREFERRED 1
+#define RBD_NUMA_BIND 2
+#define RBD_NUMA_INTERLEAVE 3
+
+/* Granularity of NUMA allocations. */
+#define RBD_NUMA_PAGE_SIZE ((size_t)4096)
+
+/* Size of the header in front of every NUMA allocation, holding its mapped length. */
+#define RBD_NUMA_HEADER_SIZE ((size_t)16)
+
+/* Number of lookups between refreshes of a thread's cached node; a thread migrated in between reads a remote */
+/* replica until the next refresh. */
+#define RBD_NUMA_NODE_REFRESH 1024
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#define RBD_NUMA_MBIND(addr, len, policy, mask) ({\
+  unsigned long _mask = (mask);\
+  syscall(SYS_mbind, (addr), (len), (policy), &_mask, 8 * sizeof(_mask), 0);\
+})
+#define RBD_NUMA_NODE() ({\
+  static __thread unsigned _node, _calls;\
+  if (!(_calls++ % RBD_NUMA_NODE_REFRESH)) {\
+    unsigned _cpu = 0;\
+    syscall(SYS_getcpu, &_cpu, &_node, NULL);\
+  }\
+  (size_t)_node;\
+})
+#else
+#define RBD_NUMA_MBIND(addr, len, policy, mask) ((void)0)
+#define RBD_NUMA_NODE() ((size_t)0)
+#endif
+
+// RBD_NUMA_GEN_DECL(Numa)
+
+/* Generate the declarations for the NUMA allocator. */
+#define RBD_NUMA_GEN_DECL(Numa)\
+\
+  /*=================================================================================================================*/\
+  /* NUMA Allocator                                                                                                  */\
+  /*=================================================================================================================*/\
+\
+  /* Allocate memory placed according to the policy. */\
+  void *RBD(Numa, _alloc)(size_t size);\
+\
+  /* Resize memory placed according to the policy, keeping it in place while it fits its pages. */\
+  void *RBD(Numa, _realloc)(void *ptr, size_t size);\
+\
+  /* Free memory placed according to the policy (null is ignored). */\
+  void RBD(Numa, _free)(void *ptr);
+
+// RBD_NUMA_GEN_DEF(Numa, Policy, Node)
+
+/* Generate the definitions for the NUMA allocator, whose functions plug into the allocator hooks of the other */
+/* generators (including the object pool slabs and the size-class allocator chunks). Every allocation is mapped */
+/* separately and bound with `mbind` to the node `Node`, an expression evaluated on each allocation, or interleaved */
+/* across all nodes for `RBD_NUMA_INTERLEAVE`. Binding failures are ignored, so placement degrades to the default */
+/* policy on hosts without NUMA. Meant for large container buffers, since every allocation takes whole pages. */
+#define RBD_NUMA_GEN_DEF(Numa, Policy, Node)\
+\
+  /*=================================================================================================================*/\
+  /* NUMA Allocator                                                                                                  */\
+  /*=================================================================================================================*/\
+\
+  void *RBD(Numa, _alloc)(size_t size) {\
+    size_t len = (size + RBD_NUMA_HEADER_SIZE + RBD_NUMA_PAGE_SIZE - 1) & ~(RBD_NUMA_PAGE_SIZE - 1);\
+    char *mem = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);\
+    if (mem == MAP_FAILED) {\
+      return NULL;\
+    }\
+    RBD_NUMA_MBIND(mem, len, Policy, (Policy) == RBD_NUMA_INTERLEAVE ? ~0UL : 1UL << ((Node) % (8 * sizeof(unsigned long))));\
+    *(size_t *)mem = len;\
+    return mem + RBD_NUMA_HEADER_SIZE;\
+  }\
+\
+  void RBD(Numa, _free)(void *ptr) {\
+    if (ptr) {\
+      char *mem = (char *)ptr - RBD_NUMA_HEADER_SIZE;\
+      munmap(mem, *(size_t *)mem);\
+    }\
+  }\
+\
+  void *RBD(Numa, _realloc)(void *ptr, size_t size) {\
+    if (!ptr) {\
+      return RBD(Numa, _alloc)(size);\
+    }\
+    size_t len = *(size_t *)((char *)ptr - RBD_NUMA_HEADER_SIZE) - RBD_NUMA_HEADER_SIZE;\
+    if (size <= len) {\
+      return ptr;\
+    }\
+    void *next = RBD(Numa, _alloc)(size);\
+    memcpy(next, ptr, len);\
+    RBD(Numa, _free)(ptr);\
+    return next;\
+  }
+
+// RBD_REPLMAP_GEN_DECL(ReplMap, Key, Val)
+
+/* Generate the declarations for the replicated map. */
+#define RBD_REPLMAP_GEN_DECL(ReplMap, Key, Val)\
+\
+  /*=================================================================================================================*/\
+  /* Replicated Map Allocator                                                                                        */\
+  /*=================================================================================================================*/\
+\
+  RBD_NUMA_GEN_DECL(RBD(ReplMap, Numa))\
+\
+  /*=================================================================================================================*/\
+  /* Replicated Map Replica                                                                                          */\
+  /*=================================================================================================================*/\
+\
+  RBD_MAP_GEN_DECL(RBD(ReplMap, Map), Key, Val)\
+\
+  /*=================================================================================================================*/\
+  /* Replicated Map                                                                                                  */\
+  /*=================================================================================================================*/\
+\
+  /* Replicated map. */\
+  typedef struct ReplMap ReplMap;\
+\
+  /* Construct a new replicated map with one replica per node and initial capacity. */\
+  ReplMap *RBD(ReplMap, _cons)(ReplMap *rmap, size_t nodes, size_t cap);\
+\
+  /* Check if the replicated map is empty. */\
+  bool RBD(ReplMap, _empty)(ReplMap *rmap);\
+\
+  /* Get the length of the replicated map. */\
+  size_t RBD(ReplMap, _len)(ReplMap *rmap);\
+\
+  /* Get the number of replicas of the replicated map. */\
+  size_t RBD(ReplMap, _nodes)(ReplMap *rmap);\
+\
+  /* Get the replica on the node of the calling thread, for lookups and iteration. */\
+  RBD(ReplMap, Map) *RBD(ReplMap, _local)(ReplMap *rmap);\
+\
+  /* Insert a new element into every replica (must not exist). */\
+  void RBD(ReplMap, _insert)(ReplMap *rmap, Key key, Val val);\
+\
+  /* Replace an existing element in every replica (must exist), calling value destructor for the old value. */\
+  void RBD(ReplMap, _replace)(ReplMap *rmap, Key key, Val val);\
+\
+  /* Get the value of the provided key from the local replica (must exist). */\
+  Val *RBD(ReplMap, _at)(ReplMap *rmap, Key key);\
+\
+  /* Check if the key exists, using the local replica. */\
+  bool RBD(ReplMap, _contains)(ReplMap *rmap, Key key);\
+\
+  /* Erase the provided element from every replica (must exist), calling key and value destructors once. */\
+  void RBD(ReplMap, _erase)(ReplMap *rmap, Key key);\
+\
+  /* Clear all elements and set length to zero, calling key and value destructors once for each element. */\
+  void RBD(ReplMap, _clear)(ReplMap *rmap);\
+\
+  /* Print the underlying representation of the replicated map, calling key and value debug for each element. */\
+  void RBD(ReplMap, _debug)(ReplMap *rmap, FILE *file, uint32_t depth);\
+\
+  /* Destruct the replicated map. */\
+  ReplMap *RBD(ReplMap, _des)(ReplMap *rmap);
+
+// RBD_REPLMAP_GEN_DEF(ReplMap, Key, /*Key_hash*/, /*Key_equals*/, /*Key_debug*/, /*Key_des*/, Val, /*&*/, /*Val_equals*/, /*Val_debug*/, /*Val_des*/)
+
+/* Generate the definitions for the replicated map, a read-mostly map keeping one replica per NUMA node. Writes go */
+/* to every replica, each allocated on its own node; lookups are routed to the replica of the calling thread's node. */
+/* Replicas hold shallow copies of keys and values, so destructors run on the first replica only. Writers must be */
+/* serialized and must not run concurrently with readers, as with the plain map. */
+#define RBD_REPLMAP_GEN_DEF(ReplMap, Key, Key_hash, Key_equals, Key_debug, Key_des, Val, Val_ref, Val_equals, Val_debug, Val_des)\
+\
+  /*=================================================================================================================*/\
+  /* Replicated Map Allocator                                                                                        */\
+  /*=================================================================================================================*/\
+\
+  /* Node that replica allocations are bound to, set before each replica is written. */\
+  static size_t RBD(ReplMap, Node);\
+\
+  RBD_NUMA_GEN_DEF(RBD(ReplMap, Numa), RBD_NUMA_BIND, RBD(ReplMap, Node))\
+\
+  /*=================================================================================================================*/\
+  /* Replicated Map Replica                                                                                          */\
+  /*=================================================================================================================*/\
+\
+  RBD_MAP_GEN_DEF(RBD(ReplMap, Map), Key, Key_hash, Key_equals, Key_debug, , Val, Val_ref, Val_equals, Val_debug, , RBD(ReplMap, Numa_alloc), RBD(ReplMap, Numa_free))\
+\
+  /*=================================================================================================================*/\
+  /* Replicated Map                                                                                                  */\
+  /*=================================================================================================================*/\
+\
+  struct ReplMap {\
+    RBD(ReplMap, Map) *replicas;\
+    size_t nodes;\
+  };\
+\
+  ReplMap *RBD(ReplMap, _cons)(ReplMap *rmap, size_t nodes, size_t cap) {\
+    rmap->replicas = malloc(nodes * sizeof(RBD(ReplMap, Map)));\
+    rmap->nodes = nodes;\
+    for (size_t i = 0; i < nodes; i++) {\
+      RBD(ReplMap, Node) = i;\
+      RBD(ReplMap, Map_cons)(&rmap->replicas[i], cap);\
+    }\
+    return rmap;\
+  }\
+\
+  bool RBD(ReplMap, _empty)(ReplMap *rmap) {\
+    return RBD(ReplMap, Map_empty)(&rmap->replicas[0]);\
+  }\
+\
+  size_t RBD(ReplMap, _len)(ReplMap *rmap) {\
+    return RBD(ReplMap, Map_len)(&rmap->replicas[0]);\
+  }\
+\
+  size_t RBD(ReplMap, _nodes)(ReplMap *rmap) {\
+    return rmap->nodes;\
+  }\
+\
+  RBD(ReplMap, Map) *RBD(ReplMap, _local)(ReplMap *rmap) {\
+    return &rmap->replicas[RBD_NUMA_NODE() % rmap->nodes];\
+  }\
+\
+  void RBD(ReplMap, _insert)(ReplMap *rmap, Key key, Val val) {\
+    for (size_t i = 0; i < rmap->nodes; i++) {\
+      RBD(ReplMap, Node) = i;\
+      RBD(ReplMap, Map_insert)(&rmap->replicas[i], key, val);\
+    }\
+  }\
+\
+  void RBD(ReplMap, _replace)(ReplMap *rmap, Key key, Val val) {\
+    RBD_IF(Val_des)(Val_des(Val_ref(*RBD(ReplMap, Map_at)(&rmap->replicas[0], key))),);\
+    for (size_t i = 0; i < rmap->nodes; i++) {\
+      RBD(ReplMap, Node) = i;\
+      RBD(ReplMap, Map_replace)(&rmap->replicas[i], key, val);\
+    }\
+  }\
+\
+  Val *RBD(ReplMap, _at)(ReplMap *rmap, Key key) {\
+    return RBD(ReplMap, Map_at)(RBD(ReplMap, _local)(rmap), key);\
+  }\
+\
+  bool RBD(ReplMap, _contains)(ReplMap *rmap, Key key) {\
+    return RBD(ReplMap, Map_contains)(RBD(ReplMap, _local)(rmap), key);\
+  }\
+\
+  void RBD(ReplMap, _erase)(ReplMap *rmap, Key key) {\
+    RBD(ReplMap, MapIter) iter = RBD(ReplMap, Map_find)(&rmap->replicas[0], key);\
+    RBD_UNUSED Key owned = *RBD(ReplMap, MapIter_key)(iter);\
+    RBD_UNUSED Val *val = RBD(ReplMap, MapIter_val)(iter);\
+    RBD_IF(Val_des)(Val_des(Val_ref(*val)),);\
+    for (size_t i = 0; i < rmap->nodes; i++) {\
+      RBD(ReplMap, Map_erase)(&rmap->replicas[i], key);\
+    }\
+    RBD_IF(Key_des)(Key_des(owned),);\
+  }\
+\
+  void RBD(ReplMap, _clear)(ReplMap *rmap) {\
+    RBD(ReplMap, Map) *map = &rmap->replicas[0];\
+    for (RBD(ReplMap, MapIter) iter = RBD(ReplMap, Map_begin)(map); !RBD(ReplMap, MapIter_equals)(iter, RBD(ReplMap, Map_end)(map)); iter = RBD(ReplMap, MapIter_next)(iter)) {\
+      RBD_IF(Key_des)(Key_des(*RBD(ReplMap, MapIter_key)(iter)),);\
+      RBD_IF(Val_des)(Val_des(Val_ref(*RBD(ReplMap, MapIter_val)(iter))),);\
+    }\
+    for (size_t i = 0; i < rmap->nodes; i++) {\
+      RBD(ReplMap, Map_clear)(&rmap->replicas[i]);\
+    }\
+  }\
+\
+  void RBD(ReplMap, _debug)(ReplMap *rmap, FILE *file, uint32_t depth) {\
+    fprintf(file, #ReplMap " (%p) {\n", rmap);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "replicas: (%p) [\n", rmap->replicas);\
+    for (size_t i = 0; i < rmap->nodes; i++) {\
+      RBD_INDENT(file, depth + 2); RBD(ReplMap, Map_debug)(&rmap->replicas[i], file, depth + 2); fprintf(file, ",\n");\
+    }\
+    RBD_INDENT(file, depth + 1); fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "nodes: %lu,\n", rmap->nodes);\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  ReplMap *RBD(ReplMap, _des)(ReplMap *rmap) {\
+    RBD(ReplMap, _clear)(rmap);\
+    for (size_t i = 0; i < rmap->nodes; i++) {\
+      RBD(ReplMap, Map_des)(&rmap->replicas[i]);\
+    }\
+    free(rmap->replicas);\
+    return rmap;\
+  }
+
+#endif // RBD_NUMA_H
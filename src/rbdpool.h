@@ -123,7 +123,7 @@
   }\
 \
   void RBD(Pool, _debug)(FILE *file, uint32_t depth) {\
-    fprintf(file, #Pool " (%p) {\n", Pool);\
+    fprintf(file, #Pool " (%p) {\n", (void *)&Pool);\
     RBD_INDENT(file, depth + 1); fprintf(file, "slabs: [\n");\
     RBD(Pool, Slab) *slab = Pool.slabs;\
     while (slab) {\
@@ -0,0 +1,422 @@
+// vim: ft=c
+
+#ifndef RBD_QUEUE_H
+#define RBD_QUEUE_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "rbddef.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define RBD_FUTEX_WAIT(addr, val) syscall(SYS_futex, (uint32_t *)(addr), FUTEX_WAIT_PRIVATE, (val), NULL, NULL, 0)
+#define RBD_FUTEX_WAKE(addr) syscall(SYS_futex, (uint32_t *)(addr), FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0)
+#else
+#include <sched.h>
+#define RBD_FUTEX_WAIT(addr, val) sched_yield()
+#define RBD_FUTEX_WAKE(addr) ((void)0)
+#endif
+
+/* Retry the operation until it succeeds, sleeping on the sequence word between attempts. */
+#define RBD_QUEUE_WAIT(op, seq, waiters)\
+  for (;;) {\
+    if (op) {\
+      break;\
+    }\
+    atomic_fetch_add(waiters, 1);\
+    atomic_thread_fence(memory_order_seq_cst);\
+    uint32_t _seq = atomic_load(seq);\
+    bool _done = (op);\
+    if (!_done) {\
+      RBD_FUTEX_WAIT(seq, _seq);\
+    }\
+    atomic_fetch_sub(waiters, 1);\
+    if (_done) {\
+      break;\
+    }\
+  }
+
+/* Wake all threads sleeping on the sequence word, if any. The fence pairs with the waiter count increment so that */
+/* either the waiter observes the completed operation or the notifier observes the waiter. */
+#define RBD_QUEUE_NOTIFY(seq, waiters)\
+  atomic_thread_fence(memory_order_seq_cst);\
+  if (atomic_load_explicit(waiters, memory_order_relaxed)) {\
+    atomic_fetch_add(seq, 1);\
+    RBD_FUTEX_WAKE(seq);\
+  }
+
+// RBD_SPSC_GEN_DECL(Spsc, Elem);
+
+/* Generate the declarations for the single-producer single-consumer queue. */
+#define RBD_SPSC_GEN_DECL(Spsc, Elem)\
+\
+  /*=================================================================================================================*/\
+  /* Spsc                                                                                                            */\
+  /*=================================================================================================================*/\
+\
+  /* Bounded single-producer single-consumer queue. */\
+  typedef struct Spsc Spsc;\
+\
+  /* Construct a new queue with capacity (rounded up to a power of two). */\
+  Spsc *RBD(Spsc, _cons)(Spsc *spsc, size_t cap);\
+\
+  /* Get the capacity of the queue. */\
+  size_t RBD(Spsc, _cap)(Spsc *spsc);\
+\
+  /* Get the length of the queue (approximate while the queue is in use). */\
+  size_t RBD(Spsc, _len)(Spsc *spsc);\
+\
+  /* Push the provided element (producer only), returning false if the queue is full. */\
+  bool RBD(Spsc, _push)(Spsc *spsc, Elem elem);\
+\
+  /* Push up to n of the provided elements (producer only), returning the number pushed. */\
+  size_t RBD(Spsc, _pushN)(Spsc *spsc, Elem *elems, size_t n);\
+\
+  /* Push the provided element (producer only), sleeping while the queue is full. */\
+  void RBD(Spsc, _pushWait)(Spsc *spsc, Elem elem);\
+\
+  /* Pop the front element into the provided pointer (consumer only), returning false if the queue is empty. */\
+  bool RBD(Spsc, _pop)(Spsc *spsc, Elem *elem);\
+\
+  /* Pop up to n elements into the provided array (consumer only), returning the number popped. */\
+  size_t RBD(Spsc, _popN)(Spsc *spsc, Elem *elems, size_t n);\
+\
+  /* Pop the front element (consumer only), sleeping while the queue is empty. */\
+  void RBD(Spsc, _popWait)(Spsc *spsc, Elem *elem);\
+\
+  /* Print the underlying representation of the queue (not thread-safe), calling element debug for each element. */\
+  void RBD(Spsc, _debug)(Spsc *spsc, FILE *file, uint32_t depth);\
+\
+  /* Destruct the queue, calling element destructor for each remaining element. */\
+  Spsc *RBD(Spsc, _des)(Spsc *spsc);
+
+// RBD_SPSC_GEN_DEF(Spsc, Elem, /*&*/, /*Elem_debug*/, /*Elem_des*/, /*Allocator_alloc*/, /*Allocator_free*/);
+
+/* Generate the definitions for the single-producer single-consumer queue. */
+#define RBD_SPSC_GEN_DEF(Spsc, Elem, Elem_ref, Elem_debug, Elem_des, Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Spsc                                                                                                            */\
+  /*=================================================================================================================*/\
+\
+  /* Head and tail are free-running and each side keeps a cached copy of the other's index on its own cache line, so */\
+  /* the shared lines are only touched when the cached view says the queue is full or empty. */\
+  struct Spsc {\
+    _Alignas(RBD_CACHE_LINE) _Atomic size_t tail;\
+    size_t headCache;\
+    _Alignas(RBD_CACHE_LINE) _Atomic size_t head;\
+    size_t tailCache;\
+    _Alignas(RBD_CACHE_LINE) Elem *elems;\
+    size_t cap;\
+    _Alignas(RBD_CACHE_LINE) _Atomic uint32_t pushSeq;\
+    _Atomic uint32_t pushWaiters;\
+    _Atomic uint32_t popSeq;\
+    _Atomic uint32_t popWaiters;\
+  };\
+\
+  Spsc *RBD(Spsc, _cons)(Spsc *spsc, size_t cap) {\
+    cap = RBD_CEIL_POW2(cap);\
+    spsc->elems = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(cap * sizeof(Elem));\
+    spsc->cap = cap;\
+    atomic_init(&spsc->tail, 0);\
+    spsc->headCache = 0;\
+    atomic_init(&spsc->head, 0);\
+    spsc->tailCache = 0;\
+    atomic_init(&spsc->pushSeq, 0);\
+    atomic_init(&spsc->pushWaiters, 0);\
+    atomic_init(&spsc->popSeq, 0);\
+    atomic_init(&spsc->popWaiters, 0);\
+    return spsc;\
+  }\
+\
+  size_t RBD(Spsc, _cap)(Spsc *spsc) {\
+    return spsc->cap;\
+  }\
+\
+  size_t RBD(Spsc, _len)(Spsc *spsc) {\
+    size_t head = atomic_load_explicit(&spsc->head, memory_order_acquire);\
+    return atomic_load_explicit(&spsc->tail, memory_order_acquire) - head;\
+  }\
+\
+  bool RBD(Spsc, _push)(Spsc *spsc, Elem elem) {\
+    return RBD(Spsc, _pushN)(spsc, &elem, 1);\
+  }\
+\
+  size_t RBD(Spsc, _pushN)(Spsc *spsc, Elem *elems, size_t n) {\
+    size_t tail = atomic_load_explicit(&spsc->tail, memory_order_relaxed);\
+    if (spsc->cap - (tail - spsc->headCache) < n) {\
+      spsc->headCache = atomic_load_explicit(&spsc->head, memory_order_acquire);\
+    }\
+    size_t avail = spsc->cap - (tail - spsc->headCache);\
+    n = (n < avail) ? n : avail;\
+    if (!n) {\
+      return 0;\
+    }\
+    size_t start = tail & (spsc->cap - 1);\
+    size_t first = (n < spsc->cap - start) ? n : spsc->cap - start;\
+    memcpy(&spsc->elems[start], &elems[0], first * sizeof(Elem));\
+    memcpy(&spsc->elems[0], &elems[first], (n - first) * sizeof(Elem));\
+    atomic_store_explicit(&spsc->tail, tail + n, memory_order_release);\
+    RBD_QUEUE_NOTIFY(&spsc->pushSeq, &spsc->popWaiters);\
+    return n;\
+  }\
+\
+  void RBD(Spsc, _pushWait)(Spsc *spsc, Elem elem) {\
+    RBD_QUEUE_WAIT(RBD(Spsc, _push)(spsc, elem), &spsc->popSeq, &spsc->pushWaiters);\
+  }\
+\
+  bool RBD(Spsc, _pop)(Spsc *spsc, Elem *elem) {\
+    return RBD(Spsc, _popN)(spsc, elem, 1);\
+  }\
+\
+  size_t RBD(Spsc, _popN)(Spsc *spsc, Elem *elems, size_t n) {\
+    size_t head = atomic_load_explicit(&spsc->head, memory_order_relaxed);\
+    if (spsc->tailCache - head < n) {\
+      spsc->tailCache = atomic_load_explicit(&spsc->tail, memory_order_acquire);\
+    }\
+    size_t len = spsc->tailCache - head;\
+    n = (n < len) ? n : len;\
+    if (!n) {\
+      return 0;\
+    }\
+    size_t start = head & (spsc->cap - 1);\
+    size_t first = (n < spsc->cap - start) ? n : spsc->cap - start;\
+    memcpy(&elems[0], &spsc->elems[start], first * sizeof(Elem));\
+    memcpy(&elems[first], &spsc->elems[0], (n - first) * sizeof(Elem));\
+    atomic_store_explicit(&spsc->head, head + n, memory_order_release);\
+    RBD_QUEUE_NOTIFY(&spsc->popSeq, &spsc->pushWaiters);\
+    return n;\
+  }\
+\
+  void RBD(Spsc, _popWait)(Spsc *spsc, Elem *elem) {\
+    RBD_QUEUE_WAIT(RBD(Spsc, _pop)(spsc, elem), &spsc->pushSeq, &spsc->popWaiters);\
+  }\
+\
+  void RBD(Spsc, _debug)(Spsc *spsc, FILE *file, uint32_t depth) {\
+    size_t head = atomic_load(&spsc->head), tail = atomic_load(&spsc->tail);\
+    fprintf(file, #Spsc " (%p) {\n", spsc);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "elems: (%p) [\n", spsc->elems);\
+    for (size_t i = head; i != tail; i++) {\
+      RBD_INDENT(file, depth + 2); RBD_IF(Elem_debug)(Elem_debug(Elem_ref(spsc->elems[i & (spsc->cap - 1)]), file, depth + 2), fprintf(file, #Spsc "Elem { ? }")); fprintf(file, ",\n");\
+    }\
+    RBD_INDENT(file, depth + 1); fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "cap: %lu,\n", spsc->cap);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "head: %lu,\n", head);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "tail: %lu,\n", tail);\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  Spsc *RBD(Spsc, _des)(Spsc *spsc) {\
+    for (size_t i = atomic_load(&spsc->head); i != atomic_load(&spsc->tail); i++) {\
+      RBD_IF(Elem_des)(Elem_des(Elem_ref(spsc->elems[i & (spsc->cap - 1)])),);\
+    }\
+    RBD_IF(Allocator_free)(Allocator_free, free)(spsc->elems);\
+    return spsc;\
+  }
+
+// RBD_MPMC_GEN_DECL(Mpmc, Elem);
+
+/* Generate the declarations for the multi-producer multi-consumer queue. */
+#define RBD_MPMC_GEN_DECL(Mpmc, Elem)\
+\
+  /*=================================================================================================================*/\
+  /* Mpmc Cell                                                                                                       */\
+  /*=================================================================================================================*/\
+\
+  /* Mpmc cell. */\
+  typedef struct RBD(Mpmc, Cell) RBD(Mpmc, Cell);\
+\
+  /*=================================================================================================================*/\
+  /* Mpmc                                                                                                            */\
+  /*=================================================================================================================*/\
+\
+  /* Bounded multi-producer multi-consumer queue. */\
+  typedef struct Mpmc Mpmc;\
+\
+  /* Construct a new queue with capacity (rounded up to a power of two). */\
+  Mpmc *RBD(Mpmc, _cons)(Mpmc *mpmc, size_t cap);\
+\
+  /* Get the capacity of the queue. */\
+  size_t RBD(Mpmc, _cap)(Mpmc *mpmc);\
+\
+  /* Get the length of the queue (approximate while the queue is in use). */\
+  size_t RBD(Mpmc, _len)(Mpmc *mpmc);\
+\
+  /* Push the provided element, returning false if the queue is full. */\
+  bool RBD(Mpmc, _push)(Mpmc *mpmc, Elem elem);\
+\
+  /* Push up to n of the provided elements as one contiguous claim, returning the number pushed. */\
+  size_t RBD(Mpmc, _pushN)(Mpmc *mpmc, Elem *elems, size_t n);\
+\
+  /* Push the provided element, sleeping while the queue is full. */\
+  void RBD(Mpmc, _pushWait)(Mpmc *mpmc, Elem elem);\
+\
+  /* Pop the front element into the provided pointer, returning false if the queue is empty. */\
+  bool RBD(Mpmc, _pop)(Mpmc *mpmc, Elem *elem);\
+\
+  /* Pop up to n elements into the provided array as one contiguous claim, returning the number popped. */\
+  size_t RBD(Mpmc, _popN)(Mpmc *mpmc, Elem *elems, size_t n);\
+\
+  /* Pop the front element, sleeping while the queue is empty. */\
+  void RBD(Mpmc, _popWait)(Mpmc *mpmc, Elem *elem);\
+\
+  /* Print the underlying representation of the queue (not thread-safe), calling element debug for each element. */\
+  void RBD(Mpmc, _debug)(Mpmc *mpmc, FILE *file, uint32_t depth);\
+\
+  /* Destruct the queue, calling element destructor for each remaining element. */\
+  Mpmc *RBD(Mpmc, _des)(Mpmc *mpmc);
+
+// RBD_MPMC_GEN_DEF(Mpmc, Elem, /*&*/, /*Elem_debug*/, /*Elem_des*/, /*Allocator_alloc*/, /*Allocator_free*/);
+
+/* Generate the definitions for the multi-producer multi-consumer queue. */
+#define RBD_MPMC_GEN_DEF(Mpmc, Elem, Elem_ref, Elem_debug, Elem_des, Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Mpmc Cell                                                                                                       */\
+  /*=================================================================================================================*/\
+\
+  /* A cell at position `pos` is free for the producer of `pos` when `seq == pos` and holds an element for the */\
+  /* consumer of `pos` when `seq == pos + 1`. */\
+  struct RBD(Mpmc, Cell) {\
+    _Atomic size_t seq;\
+    Elem elem;\
+  };\
+\
+  /*=================================================================================================================*/\
+  /* Mpmc                                                                                                            */\
+  /*=================================================================================================================*/\
+\
+  struct Mpmc {\
+    _Alignas(RBD_CACHE_LINE) _Atomic size_t tail;\
+    _Alignas(RBD_CACHE_LINE) _Atomic size_t head;\
+    _Alignas(RBD_CACHE_LINE) RBD(Mpmc, Cell) *cells;\
+    size_t cap;\
+    _Alignas(RBD_CACHE_LINE) _Atomic uint32_t pushSeq;\
+    _Atomic uint32_t pushWaiters;\
+    _Atomic uint32_t popSeq;\
+    _Atomic uint32_t popWaiters;\
+  };\
+\
+  Mpmc *RBD(Mpmc, _cons)(Mpmc *mpmc, size_t cap) {\
+    cap = RBD_CEIL_POW2(cap);\
+    mpmc->cells = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(cap * sizeof(RBD(Mpmc, Cell)));\
+    mpmc->cap = cap;\
+    for (size_t i = 0; i < cap; i++) {\
+      atomic_init(&mpmc->cells[i].seq, i);\
+    }\
+    atomic_init(&mpmc->tail, 0);\
+    atomic_init(&mpmc->head, 0);\
+    atomic_init(&mpmc->pushSeq, 0);\
+    atomic_init(&mpmc->pushWaiters, 0);\
+    atomic_init(&mpmc->popSeq, 0);\
+    atomic_init(&mpmc->popWaiters, 0);\
+    return mpmc;\
+  }\
+\
+  size_t RBD(Mpmc, _cap)(Mpmc *mpmc) {\
+    return mpmc->cap;\
+  }\
+\
+  size_t RBD(Mpmc, _len)(Mpmc *mpmc) {\
+    size_t head = atomic_load_explicit(&mpmc->head, memory_order_acquire);\
+    size_t tail = atomic_load_explicit(&mpmc->tail, memory_order_acquire);\
+    return (tail > head) ? tail - head : 0;\
+  }\
+\
+  bool RBD(Mpmc, _push)(Mpmc *mpmc, Elem elem) {\
+    return RBD(Mpmc, _pushN)(mpmc, &elem, 1);\
+  }\
+\
+  /* Claim up to n consecutive cells whose sequence equals their position plus the offset, returning the number */\
+  /* claimed and storing the first claimed position. */\
+  size_t RBD(Mpmc, _claim)(Mpmc *mpmc, _Atomic size_t *pos, size_t off, size_t n, size_t *start) {\
+    size_t curr = atomic_load_explicit(pos, memory_order_relaxed);\
+    for (;;) {\
+      size_t k = 0;\
+      while (k < n && atomic_load_explicit(&mpmc->cells[(curr + k) & (mpmc->cap - 1)].seq, memory_order_acquire) == curr + k + off) {\
+        k++;\
+      }\
+      if (!k) {\
+        size_t seq = atomic_load_explicit(&mpmc->cells[curr & (mpmc->cap - 1)].seq, memory_order_acquire);\
+        if ((intptr_t)(seq - (curr + off)) < 0) {\
+          return 0;\
+        }\
+        curr = atomic_load_explicit(pos, memory_order_relaxed);\
+      } else if (atomic_compare_exchange_weak_explicit(pos, &curr, curr + k, memory_order_relaxed, memory_order_relaxed)) {\
+        *start = curr;\
+        return k;\
+      }\
+    }\
+  }\
+\
+  size_t RBD(Mpmc, _pushN)(Mpmc *mpmc, Elem *elems, size_t n) {\
+    size_t start;\
+    n = RBD(Mpmc, _claim)(mpmc, &mpmc->tail, 0, n, &start);\
+    for (size_t i = 0; i < n; i++) {\
+      RBD(Mpmc, Cell) *cell = &mpmc->cells[(start + i) & (mpmc->cap - 1)];\
+      cell->elem = elems[i];\
+      atomic_store_explicit(&cell->seq, start + i + 1, memory_order_release);\
+    }\
+    if (n) {\
+      RBD_QUEUE_NOTIFY(&mpmc->pushSeq, &mpmc->popWaiters);\
+    }\
+    return n;\
+  }\
+\
+  void RBD(Mpmc, _pushWait)(Mpmc *mpmc, Elem elem) {\
+    RBD_QUEUE_WAIT(RBD(Mpmc, _push)(mpmc, elem), &mpmc->popSeq, &mpmc->pushWaiters);\
+  }\
+\
+  bool RBD(Mpmc, _pop)(Mpmc *mpmc, Elem *elem) {\
+    return RBD(Mpmc, _popN)(mpmc, elem, 1);\
+  }\
+\
+  size_t RBD(Mpmc, _popN)(Mpmc *mpmc, Elem *elems, size_t n) {\
+    size_t start;\
+    n = RBD(Mpmc, _claim)(mpmc, &mpmc->head, 1, n, &start);\
+    for (size_t i = 0; i < n; i++) {\
+      RBD(Mpmc, Cell) *cell = &mpmc->cells[(start + i) & (mpmc->cap - 1)];\
+      elems[i] = cell->elem;\
+      atomic_store_explicit(&cell->seq, start + i + mpmc->cap, memory_order_release);\
+    }\
+    if (n) {\
+      RBD_QUEUE_NOTIFY(&mpmc->popSeq, &mpmc->pushWaiters);\
+    }\
+    return n;\
+  }\
+\
+  void RBD(Mpmc, _popWait)(Mpmc *mpmc, Elem *elem) {\
+    RBD_QUEUE_WAIT(RBD(Mpmc, _pop)(mpmc, elem), &mpmc->pushSeq, &mpmc->popWaiters);\
+  }\
+\
+  void RBD(Mpmc, _debug)(Mpmc *mpmc, FILE *file, uint32_t depth) {\
+    size_t head = atomic_load(&mpmc->head), tail = atomic_load(&mpmc->tail);\
+    fprintf(file, #Mpmc " (%p) {\n", mpmc);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "cells: (%p) [\n", mpmc->cells);\
+    for (size_t i = head; i != tail; i++) {\
+      RBD_INDENT(file, depth + 2); RBD_IF(Elem_debug)(Elem_debug(Elem_ref(mpmc->cells[i & (mpmc->cap - 1)].elem), file, depth + 2), fprintf(file, #Mpmc "Elem { ? }")); fprintf(file, ",\n");\
+    }\
+    RBD_INDENT(file, depth + 1); fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "cap: %lu,\n", mpmc->cap);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "head: %lu,\n", head);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "tail: %lu,\n", tail);\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  Mpmc *RBD(Mpmc, _des)(Mpmc *mpmc) {\
+    for (size_t i = atomic_load(&mpmc->head); i != atomic_load(&mpmc->tail); i++) {\
+      RBD_IF(Elem_des)(Elem_des(Elem_ref(mpmc->cells[i & (mpmc->cap - 1)].elem)),);\
+    }\
+    RBD_IF(Allocator_free)(Allocator_free, free)(mpmc->cells);\
+    return mpmc;\
+  }
+
+#endif // RBD_QUEUE_H
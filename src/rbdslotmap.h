@@ -0,0 +1,388 @@
+// vim: ft=c
+
+#ifndef RBD_SLOTMAP_H
+#define RBD_SLOTMAP_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "rbddef.h"
+
+/* Number of handle bits holding the slot index, between 1 and 31; the remaining high bits hold the generation. */
+/* Define it before including this header to trade slots for generations. */
+#ifndef RBD_SLOTMAP_INDEX_BITS
+#define RBD_SLOTMAP_INDEX_BITS 24
+#endif
+
+/* Mask of the handle bits holding the slot index. */
+#define RBD_SLOTMAP_INDEX_MASK (((uint32_t)1 << RBD_SLOTMAP_INDEX_BITS) - 1)
+
+/* Maximum number of slots in a slot map. */
+#define RBD_SLOTMAP_INDEX_MAX ((size_t)RBD_SLOTMAP_INDEX_MASK + 1)
+
+/* Maximum generation of a slot; a slot released at this generation is retired. */
+#define RBD_SLOTMAP_GEN_MAX (UINT32_MAX >> RBD_SLOTMAP_INDEX_BITS)
+
+/* Handle that never refers to an element, since generations start at one. */
+#define RBD_SLOTMAP_NULL 0
+
+// RBD_SLOTMAP_GEN_DECL(SlotMap, Elem)
+
+/* Generate the declarations for the slot map. */
+#define RBD_SLOTMAP_GEN_DECL(SlotMap, Elem)\
+\
+  /*=================================================================================================================*/\
+  /* Slot Map Handle                                                                                                 */\
+  /*=================================================================================================================*/\
+\
+  /* Slot map handle, the slot index in the low bits and its generation in the high bits. */\
+  typedef uint32_t RBD(SlotMap, Handle);\
+\
+  /*=================================================================================================================*/\
+  /* Slot Map Slot                                                                                                   */\
+  /*=================================================================================================================*/\
+\
+  /* Slot map slot. */\
+  typedef struct RBD(SlotMap, Slot) RBD(SlotMap, Slot);\
+\
+  /*=================================================================================================================*/\
+  /* Slot Map Iterator                                                                                               */\
+  /*=================================================================================================================*/\
+\
+  /* Slot map iterator. */\
+  typedef struct RBD(SlotMap, Iter) RBD(SlotMap, Iter);\
+\
+  /* Slot map. */\
+  typedef struct SlotMap SlotMap;\
+\
+  /* Construct a new slot map iterator. */\
+  RBD(SlotMap, Iter) RBD(SlotMap, Iter_cons)(SlotMap *slotmap, size_t i);\
+\
+  /* Advance the slot map iterator to the next element. */\
+  RBD(SlotMap, Iter) RBD(SlotMap, Iter_next)(RBD(SlotMap, Iter) iter);\
+\
+  /* Get the element at the current position. */\
+  Elem *RBD(SlotMap, Iter_elem)(RBD(SlotMap, Iter) iter);\
+\
+  /* Get the handle of the element at the current position. */\
+  RBD(SlotMap, Handle) RBD(SlotMap, Iter_handle)(RBD(SlotMap, Iter) iter);\
+\
+  /* Check if two iterators point to the same element. */\
+  bool RBD(SlotMap, Iter_equals)(RBD(SlotMap, Iter) a, RBD(SlotMap, Iter) b);\
+\
+  /* Print the underlying representation of the iterator with depth indentation. */\
+  void RBD(SlotMap, Iter_debug)(RBD(SlotMap, Iter) iter, FILE *file, uint32_t depth);\
+\
+  /* Destruct the slot map iterator. */\
+  RBD(SlotMap, Iter) RBD(SlotMap, Iter_des)(RBD(SlotMap, Iter) iter);\
+\
+  /*=================================================================================================================*/\
+  /* Slot Map                                                                                                        */\
+  /*=================================================================================================================*/\
+\
+  /* Construct a new slot map with initial capacity. */\
+  SlotMap *RBD(SlotMap, _cons)(SlotMap *slotmap, size_t cap);\
+\
+  /* Check if the slot map is empty. */\
+  bool RBD(SlotMap, _empty)(SlotMap *slotmap);\
+\
+  /* Get the capacity of the slot map. */\
+  size_t RBD(SlotMap, _cap)(SlotMap *slotmap);\
+\
+  /* Get the length of the slot map. */\
+  size_t RBD(SlotMap, _len)(SlotMap *slotmap);\
+\
+  /* Reserve at least the provided capacity. */\
+  void RBD(SlotMap, _reserve)(SlotMap *slotmap, size_t cap);\
+\
+  /* Insert a new element, returning its handle. Returns `RBD_SLOTMAP_NULL`, calling element destructor, once */\
+  /* `RBD_SLOTMAP_INDEX_MAX` slots have been created and none is free. */\
+  RBD(SlotMap, Handle) RBD(SlotMap, _insert)(SlotMap *slotmap, Elem elem);\
+\
+  /* Same as `insert`, but storing the handle and returning a pointer to the element to-be-constructed, or null if */\
+  /* no slot is left. */\
+  Elem *RBD(SlotMap, _emplace)(SlotMap *slotmap, RBD(SlotMap, Handle) *handle);\
+\
+  /* Check if the handle refers to a live element. */\
+  bool RBD(SlotMap, _contains)(SlotMap *slotmap, RBD(SlotMap, Handle) handle);\
+\
+  /* Get the element of the provided handle (must be live). */\
+  Elem *RBD(SlotMap, _at)(SlotMap *slotmap, RBD(SlotMap, Handle) handle);\
+\
+  /* Get the element of the provided handle, or null if it is stale. */\
+  Elem *RBD(SlotMap, _get)(SlotMap *slotmap, RBD(SlotMap, Handle) handle);\
+\
+  /* Erase the element of the provided handle, calling element destructor. Returns false if the handle is stale. */\
+  bool RBD(SlotMap, _erase)(SlotMap *slotmap, RBD(SlotMap, Handle) handle);\
+\
+  /* Clear all elements and set length to zero, calling element destructor for each element. Every handle becomes */\
+  /* stale. */\
+  void RBD(SlotMap, _clear)(SlotMap *slotmap);\
+\
+  /* Return iterator starting at first element. Elements are densely packed, in no particular order. */\
+  RBD(SlotMap, Iter) RBD(SlotMap, _begin)(SlotMap *slotmap);\
+\
+  /* Return iterator starting after last element. */\
+  RBD(SlotMap, Iter) RBD(SlotMap, _end)(SlotMap *slotmap);\
+\
+  /* Print the underlying representation of the slot map, calling element debug for each element. */\
+  void RBD(SlotMap, _debug)(SlotMap *slotmap, FILE *file, uint32_t depth);\
+\
+  /* Destruct the slot map, calling element destructor for each element. */\
+  SlotMap *RBD(SlotMap, _des)(SlotMap *slotmap);
+
+// RBD_SLOTMAP_GEN_DEF(SlotMap, Elem, /*&*/, /*Elem_debug*/, /*Elem_des*/, /*Allocator_alloc*/, /*Allocator_realloc*/, /*Allocator_free*/)
+
+/* Generate the definitions for the slot map. Live elements are packed densely; each slot holds the dense index of */
+/* its element, and each element records its slot, so erasing swaps the last element into the hole. Free slots form */
+/* an intrusive list as in the object pool. A slot whose generation would wrap is retired instead of reused, so a */
+/* stale handle is never mistaken for a live one. */
+#define RBD_SLOTMAP_GEN_DEF(SlotMap, Elem, Elem_ref, Elem_debug, Elem_des, Allocator_alloc, Allocator_realloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* Slot Map Slot                                                                                                   */\
+  /*=================================================================================================================*/\
+\
+  /* The index is the dense index of the element if live, otherwise the next free slot. */\
+  struct RBD(SlotMap, Slot) {\
+    uint32_t index;\
+    uint32_t gen;\
+    bool live;\
+  };\
+\
+  /* Print the underlying representation of the slot map slot with depth indentation. */\
+  void RBD(SlotMap, Slot_debug)(RBD(SlotMap, Slot) *slot, FILE *file, RBD_UNUSED uint32_t depth) {\
+    fprintf(file, #SlotMap "Slot { index: %u, gen: %u, live: %s }", slot->index, slot->gen, slot->live ? "true" : "false");\
+  }\
+\
+  /*=================================================================================================================*/\
+  /* Slot Map Iterator                                                                                               */\
+  /*=================================================================================================================*/\
+\
+  struct RBD(SlotMap, Iter) {\
+    SlotMap *slotmap;\
+    size_t i;\
+  };\
+\
+  RBD(SlotMap, Iter) RBD(SlotMap, Iter_cons)(SlotMap *slotmap, size_t i) {\
+    return (RBD(SlotMap, Iter)) {\
+      .slotmap = slotmap,\
+      .i = i,\
+    };\
+  }\
+\
+  RBD(SlotMap, Iter) RBD(SlotMap, Iter_next)(RBD(SlotMap, Iter) iter) {\
+    iter.i++;\
+    return iter;\
+  }\
+\
+  bool RBD(SlotMap, Iter_equals)(RBD(SlotMap, Iter) a, RBD(SlotMap, Iter) b) {\
+    return (a.slotmap == b.slotmap && a.i == b.i);\
+  }\
+\
+  void RBD(SlotMap, Iter_debug)(RBD(SlotMap, Iter) iter, FILE *file, RBD_UNUSED uint32_t depth) {\
+    fprintf(file, #SlotMap "Iter { slotmap: %p, i: %lu }", iter.slotmap, iter.i);\
+  }\
+\
+  RBD(SlotMap, Iter) RBD(SlotMap, Iter_des)(RBD(SlotMap, Iter) iter) {\
+    return iter;\
+  }\
+\
+  /*=================================================================================================================*/\
+  /* Slot Map                                                                                                        */\
+  /*=================================================================================================================*/\
+\
+  /* Elements and owners are dense and parallel; slots are sparse. All three share the capacity. */\
+  struct SlotMap {\
+    Elem *elems;\
+    uint32_t *owners;\
+    RBD(SlotMap, Slot) *slots;\
+    size_t cap;\
+    size_t len;\
+    size_t nslots;\
+    uint32_t frees;\
+  };\
+\
+  Elem *RBD(SlotMap, Iter_elem)(RBD(SlotMap, Iter) iter) {\
+    return &iter.slotmap->elems[iter.i];\
+  }\
+\
+  RBD(SlotMap, Handle) RBD(SlotMap, Iter_handle)(RBD(SlotMap, Iter) iter) {\
+    uint32_t index = iter.slotmap->owners[iter.i];\
+    return (iter.slotmap->slots[index].gen << RBD_SLOTMAP_INDEX_BITS) | index;\
+  }\
+\
+  SlotMap *RBD(SlotMap, _cons)(SlotMap *slotmap, size_t cap) {\
+    *slotmap = (SlotMap) {\
+      .elems = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(cap * sizeof(Elem)),\
+      .owners = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(cap * sizeof(uint32_t)),\
+      .slots = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(cap * sizeof(RBD(SlotMap, Slot))),\
+      .cap = cap,\
+      .len = 0,\
+      .nslots = 0,\
+      .frees = UINT32_MAX,\
+    };\
+    return slotmap;\
+  }\
+\
+  bool RBD(SlotMap, _empty)(SlotMap *slotmap) {\
+    return !slotmap->len;\
+  }\
+\
+  size_t RBD(SlotMap, _cap)(SlotMap *slotmap) {\
+    return slotmap->cap;\
+  }\
+\
+  size_t RBD(SlotMap, _len)(SlotMap *slotmap) {\
+    return slotmap->len;\
+  }\
+\
+  /* Reserve at least the provided capacity, assuming capacity is larger than current. */\
+  void RBD(SlotMap, _reserveUnchecked)(SlotMap *slotmap, size_t cap) {\
+    slotmap->elems = RBD_IF(Allocator_realloc)(Allocator_realloc, realloc)(slotmap->elems, cap * sizeof(Elem));\
+    slotmap->owners = RBD_IF(Allocator_realloc)(Allocator_realloc, realloc)(slotmap->owners, cap * sizeof(uint32_t));\
+    slotmap->slots = RBD_IF(Allocator_realloc)(Allocator_realloc, realloc)(slotmap->slots, cap * sizeof(RBD(SlotMap, Slot)));\
+    slotmap->cap = cap;\
+  }\
+\
+  void RBD(SlotMap, _reserve)(SlotMap *slotmap, size_t cap) {\
+    if (cap > slotmap->cap) {\
+      RBD(SlotMap, _reserveUnchecked)(slotmap, cap);\
+    }\
+  }\
+\
+  Elem *RBD(SlotMap, _emplace)(SlotMap *slotmap, RBD(SlotMap, Handle) *handle) {\
+    uint32_t index = slotmap->frees;\
+    if (index == UINT32_MAX) {\
+      if (slotmap->nslots == RBD_SLOTMAP_INDEX_MAX) {\
+        *handle = RBD_SLOTMAP_NULL;\
+        return NULL;\
+      }\
+      if (slotmap->nslots == slotmap->cap) {\
+        RBD(SlotMap, _reserveUnchecked)(slotmap, slotmap->cap ? slotmap->cap * 2 : 1);\
+      }\
+      index = (uint32_t)slotmap->nslots++;\
+      slotmap->slots[index].gen = 1;\
+    } else {\
+      slotmap->frees = slotmap->slots[index].index;\
+    }\
+    RBD(SlotMap, Slot) *slot = &slotmap->slots[index];\
+    slot->index = (uint32_t)slotmap->len;\
+    slot->live = true;\
+    slotmap->owners[slotmap->len] = index;\
+    *handle = (slot->gen << RBD_SLOTMAP_INDEX_BITS) | index;\
+    return &slotmap->elems[slotmap->len++];\
+  }\
+\
+  RBD(SlotMap, Handle) RBD(SlotMap, _insert)(SlotMap *slotmap, Elem elem) {\
+    RBD(SlotMap, Handle) handle;\
+    Elem *slot = RBD(SlotMap, _emplace)(slotmap, &handle);\
+    if (!slot) {\
+      RBD_IF(Elem_des)(Elem_des(Elem_ref(elem)),);\
+      return handle;\
+    }\
+    *slot = elem;\
+    return handle;\
+  }\
+\
+  /* Get the slot of the handle, or null if the handle is stale. */\
+  RBD(SlotMap, Slot) *RBD(SlotMap, _slot)(SlotMap *slotmap, RBD(SlotMap, Handle) handle) {\
+    uint32_t index = handle & RBD_SLOTMAP_INDEX_MASK;\
+    if (index >= slotmap->nslots) {\
+      return NULL;\
+    }\
+    RBD(SlotMap, Slot) *slot = &slotmap->slots[index];\
+    return (slot->live && slot->gen == handle >> RBD_SLOTMAP_INDEX_BITS) ? slot : NULL;\
+  }\
+\
+  bool RBD(SlotMap, _contains)(SlotMap *slotmap, RBD(SlotMap, Handle) handle) {\
+    return RBD(SlotMap, _slot)(slotmap, handle) != NULL;\
+  }\
+\
+  Elem *RBD(SlotMap, _at)(SlotMap *slotmap, RBD(SlotMap, Handle) handle) {\
+    return &slotmap->elems[slotmap->slots[handle & RBD_SLOTMAP_INDEX_MASK].index];\
+  }\
+\
+  Elem *RBD(SlotMap, _get)(SlotMap *slotmap, RBD(SlotMap, Handle) handle) {\
+    RBD(SlotMap, Slot) *slot = RBD(SlotMap, _slot)(slotmap, handle);\
+    return slot ? &slotmap->elems[slot->index] : NULL;\
+  }\
+\
+  /* Release the slot, advancing its generation and retiring it if the generation wraps. */\
+  void RBD(SlotMap, _release)(SlotMap *slotmap, uint32_t index) {\
+    RBD(SlotMap, Slot) *slot = &slotmap->slots[index];\
+    slot->live = false;\
+    if (slot->gen++ < RBD_SLOTMAP_GEN_MAX) {\
+      slot->index = slotmap->frees;\
+      slotmap->frees = index;\
+    }\
+  }\
+\
+  bool RBD(SlotMap, _erase)(SlotMap *slotmap, RBD(SlotMap, Handle) handle) {\
+    RBD(SlotMap, Slot) *slot = RBD(SlotMap, _slot)(slotmap, handle);\
+    if (!slot) {\
+      return false;\
+    }\
+    uint32_t i = slot->index, last = (uint32_t)--slotmap->len;\
+    RBD_IF(Elem_des)(Elem_des(Elem_ref(slotmap->elems[i])),);\
+    slotmap->elems[i] = slotmap->elems[last];\
+    slotmap->owners[i] = slotmap->owners[last];\
+    slotmap->slots[slotmap->owners[i]].index = i;\
+    RBD(SlotMap, _release)(slotmap, handle & RBD_SLOTMAP_INDEX_MASK);\
+    return true;\
+  }\
+\
+  void RBD(SlotMap, _clear)(SlotMap *slotmap) {\
+    for (size_t i = 0; i < slotmap->len; i++) {\
+      RBD_IF(Elem_des)(Elem_des(Elem_ref(slotmap->elems[i])),);\
+      RBD(SlotMap, _release)(slotmap, slotmap->owners[i]);\
+    }\
+    slotmap->len = 0;\
+  }\
+\
+  RBD(SlotMap, Iter) RBD(SlotMap, _begin)(SlotMap *slotmap) {\
+    return RBD(SlotMap, Iter_cons)(slotmap, 0);\
+  }\
+\
+  RBD(SlotMap, Iter) RBD(SlotMap, _end)(SlotMap *slotmap) {\
+    return RBD(SlotMap, Iter_cons)(slotmap, slotmap->len);\
+  }\
+\
+  void RBD(SlotMap, _debug)(SlotMap *slotmap, FILE *file, uint32_t depth) {\
+    fprintf(file, #SlotMap " (%p) {\n", slotmap);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "elems: (%p) [\n", slotmap->elems);\
+    for (size_t i = 0; i < slotmap->len; i++) {\
+      RBD_INDENT(file, depth + 2); RBD_IF(Elem_debug)(Elem_debug(Elem_ref(slotmap->elems[i]), file, depth + 2), fprintf(file, #SlotMap "Elem { ? }")); fprintf(file, ",\n");\
+    }\
+    RBD_INDENT(file, depth + 1); fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "owners: (%p) [", slotmap->owners);\
+    for (size_t i = 0; i < slotmap->len; i++) {\
+      fprintf(file, i ? ", %u" : "%u", slotmap->owners[i]);\
+    }\
+    fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "slots: (%p) [\n", slotmap->slots);\
+    for (size_t i = 0; i < slotmap->nslots; i++) {\
+      RBD_INDENT(file, depth + 2); RBD(SlotMap, Slot_debug)(&slotmap->slots[i], file, depth + 2); fprintf(file, ",\n");\
+    }\
+    RBD_INDENT(file, depth + 1); fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "cap: %lu,\n", slotmap->cap);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "len: %lu,\n", slotmap->len);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "nslots: %lu,\n", slotmap->nslots);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "frees: %u,\n", slotmap->frees);\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  SlotMap *RBD(SlotMap, _des)(SlotMap *slotmap) {\
+    for (size_t i = 0; i < slotmap->len; i++) {\
+      RBD_IF(Elem_des)(Elem_des(Elem_ref(slotmap->elems[i])),);\
+    }\
+    RBD_IF(Allocator_free)(Allocator_free, free)(slotmap->elems);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(slotmap->owners);\
+    RBD_IF(Allocator_free)(Allocator_free, free)(slotmap->slots);\
+    return slotmap;\
+  }
+
+#endif // RBD_SLOTMAP_H
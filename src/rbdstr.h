@@ -0,0 +1,355 @@
+// vim: ft=c
+
+#ifndef RBD_STR_H
+#define RBD_STR_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rbddef.h"
+#include "rbdmap.h"
+
+/* Longest string stored inline, leaving room for the terminating null. */
+#define RBD_STR_INLINE_LEN 15
+
+/* Size of a string arena block; longer strings get a block of their own. */
+#define RBD_STR_ARENA_BLOCK ((size_t)1 << 16)
+
+// RBD_STR_GEN_DECL(Str)
+
+/* Generate the declarations for the string key. */
+#define RBD_STR_GEN_DECL(Str)\
+\
+  /*=================================================================================================================*/\
+  /* String                                                                                                          */\
+  /*=================================================================================================================*/\
+\
+  /* String key. */\
+  typedef struct Str Str;\
+\
+  /*=================================================================================================================*/\
+  /* String Arena                                                                                                    */\
+  /*=================================================================================================================*/\
+\
+  /* String arena block. */\
+  typedef struct RBD(Str, Block) RBD(Str, Block);\
+\
+  /* String arena. */\
+  typedef struct RBD(Str, Arena) RBD(Str, Arena);\
+\
+  /* Construct a new string arena. */\
+  RBD(Str, Arena) *RBD(Str, Arena_cons)(RBD(Str, Arena) *arena);\
+\
+  /* Get the number of bytes held by the string arena. */\
+  size_t RBD(Str, Arena_len)(RBD(Str, Arena) *arena);\
+\
+  /* Free every string in the string arena at once. */\
+  void RBD(Str, Arena_clear)(RBD(Str, Arena) *arena);\
+\
+  /* Print the underlying representation of the string arena with depth indentation. */\
+  void RBD(Str, Arena_debug)(RBD(Str, Arena) *arena, FILE *file, uint32_t depth);\
+\
+  /* Destruct the string arena. */\
+  RBD(Str, Arena) *RBD(Str, Arena_des)(RBD(Str, Arena) *arena);\
+\
+  /*=================================================================================================================*/\
+  /* String                                                                                                          */\
+  /*=================================================================================================================*/\
+\
+  /* Construct a new string, copying it into the arena if it does not fit inline. */\
+  Str *RBD(Str, _cons)(Str *str, RBD(Str, Arena) *arena, const char *data, size_t len);\
+\
+  /* Construct a new string referring to the provided data without copying, e.g. for lookups. The data must outlive */\
+  /* the string. */\
+  Str *RBD(Str, _view)(Str *str, const char *data, size_t len);\
+\
+  /* Get the null-terminated characters of the string (for views, the provided data). */\
+  const char *RBD(Str, _data)(Str *str);\
+\
+  /* Get the length of the string. */\
+  size_t RBD(Str, _len)(Str *str);\
+\
+  /* Get the hash of the string, for use as the map key hash. */\
+  size_t RBD(Str, _hash)(Str str);\
+\
+  /* Check if two strings are equal, comparing length and hash before any characters, for use as the map key */\
+  /* equals. */\
+  bool RBD(Str, _equals)(Str a, Str b);\
+\
+  /* Check if two interned strings are equal by comparing their representations only, for use as the map key */\
+  /* equals when every key comes from the same intern table. */\
+  bool RBD(Str, _equalsInterned)(Str a, Str b);\
+\
+  /* Print the string, for use as the map key debug. */\
+  void RBD(Str, _debug)(Str str, FILE *file, uint32_t depth);\
+\
+  /*=================================================================================================================*/\
+  /* String Intern Index                                                                                             */\
+  /*=================================================================================================================*/\
+\
+  RBD_MAP_GEN_DECL(RBD(Str, InternMap), Str, uint32_t)\
+\
+  /*=================================================================================================================*/\
+  /* String Intern Table                                                                                             */\
+  /*=================================================================================================================*/\
+\
+  /* String intern table. */\
+  typedef struct RBD(Str, Intern) RBD(Str, Intern);\
+\
+  /* Construct a new string intern table with initial capacity. */\
+  RBD(Str, Intern) *RBD(Str, Intern_cons)(RBD(Str, Intern) *intern, size_t cap);\
+\
+  /* Get the number of distinct strings in the string intern table. */\
+  size_t RBD(Str, Intern_len)(RBD(Str, Intern) *intern);\
+\
+  /* Get the single copy of the provided string, adding it if missing. Equal strings interned by the same table */\
+  /* have identical representations. */\
+  Str RBD(Str, Intern_str)(RBD(Str, Intern) *intern, const char *data, size_t len);\
+\
+  /* Get the id of the interned string, dense in order of first interning. */\
+  uint32_t RBD(Str, Intern_id)(RBD(Str, Intern) *intern, Str str);\
+\
+  /* Print the underlying representation of the string intern table with depth indentation. */\
+  void RBD(Str, Intern_debug)(RBD(Str, Intern) *intern, FILE *file, uint32_t depth);\
+\
+  /* Destruct the string intern table, invalidating every string it returned. */\
+  RBD(Str, Intern) *RBD(Str, Intern_des)(RBD(Str, Intern) *intern);
+
+// RBD_STR_GEN_DEF(Str, /*Allocator_alloc*/, /*Allocator_free*/)
+
+/* Generate the definitions for the string key. A string is 24 bytes: its length, a 32-bit hash, and either up to 15 */
+/* inline characters or a pointer to the characters in an arena. Short keys are thus compared inside the map slot, */
+/* and long keys are rejected by length and hash before the pointer is followed. */
+#define RBD_STR_GEN_DEF(Str, Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* String                                                                                                          */\
+  /*=================================================================================================================*/\
+\
+  /* Inline characters are zero-padded so that short strings compare as whole words. */\
+  struct Str {\
+    uint32_t len;\
+    uint32_t hash;\
+    union {\
+      char chars[RBD_STR_INLINE_LEN + 1];\
+      const char *ptr;\
+    };\
+  };\
+\
+  /*=================================================================================================================*/\
+  /* String Arena                                                                                                    */\
+  /*=================================================================================================================*/\
+\
+  struct RBD(Str, Block) {\
+    RBD(Str, Block) *next;\
+    size_t cap;\
+    size_t len;\
+    char chars[];\
+  };\
+\
+  struct RBD(Str, Arena) {\
+    RBD(Str, Block) *blocks;\
+    size_t len;\
+  };\
+\
+  RBD(Str, Arena) *RBD(Str, Arena_cons)(RBD(Str, Arena) *arena) {\
+    *arena = (RBD(Str, Arena)) {\
+      .blocks = NULL,\
+      .len = 0,\
+    };\
+    return arena;\
+  }\
+\
+  size_t RBD(Str, Arena_len)(RBD(Str, Arena) *arena) {\
+    return arena->len;\
+  }\
+\
+  /* Copy the characters into the string arena with a terminating null. */\
+  const char *RBD(Str, Arena_copy)(RBD(Str, Arena) *arena, const char *data, size_t len) {\
+    RBD(Str, Block) *block = arena->blocks;\
+    if (!block || block->cap - block->len < len + 1) {\
+      size_t cap = (len + 1 > RBD_STR_ARENA_BLOCK) ? len + 1 : RBD_STR_ARENA_BLOCK;\
+      block = RBD_IF(Allocator_alloc)(Allocator_alloc, malloc)(sizeof(RBD(Str, Block)) + cap);\
+      block->cap = cap;\
+      block->len = 0;\
+      if (cap == RBD_STR_ARENA_BLOCK || !arena->blocks) {\
+        block->next = arena->blocks;\
+        arena->blocks = block;\
+      } else {\
+        block->next = arena->blocks->next;\
+        arena->blocks->next = block;\
+      }\
+    }\
+    char *chars = &block->chars[block->len];\
+    memcpy(chars, data, len);\
+    chars[len] = '\0';\
+    block->len += len + 1;\
+    arena->len += len + 1;\
+    return chars;\
+  }\
+\
+  void RBD(Str, Arena_clear)(RBD(Str, Arena) *arena) {\
+    RBD(Str, Block) *curr = arena->blocks, *next;\
+    while (curr) {\
+      next = curr->next;\
+      RBD_IF(Allocator_free)(Allocator_free, free)(curr);\
+      curr = next;\
+    }\
+    arena->blocks = NULL;\
+    arena->len = 0;\
+  }\
+\
+  void RBD(Str, Arena_debug)(RBD(Str, Arena) *arena, FILE *file, uint32_t depth) {\
+    fprintf(file, #Str "Arena (%p) {\n", arena);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "blocks: [\n");\
+    for (RBD(Str, Block) *block = arena->blocks; block; block = block->next) {\
+      RBD_INDENT(file, depth + 2); fprintf(file, #Str "Block (%p) { cap: %lu, len: %lu },\n", block, block->cap, block->len);\
+    }\
+    RBD_INDENT(file, depth + 1); fprintf(file, "],\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "len: %lu,\n", arena->len);\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  RBD(Str, Arena) *RBD(Str, Arena_des)(RBD(Str, Arena) *arena) {\
+    RBD(Str, Arena_clear)(arena);\
+    return arena;\
+  }\
+\
+  /*=================================================================================================================*/\
+  /* String                                                                                                          */\
+  /*=================================================================================================================*/\
+\
+  /* Hash the characters eight bytes at a time. */\
+  uint32_t RBD(Str, _hashChars)(const char *data, size_t len) {\
+    uint64_t hash = len * 0x9e3779b97f4a7c15ULL;\
+    size_t i = 0;\
+    for (; i + 8 <= len; i += 8) {\
+      uint64_t word;\
+      memcpy(&word, &data[i], 8);\
+      hash = (hash ^ word) * 0xbf58476d1ce4e5b9ULL;\
+      hash ^= hash >> 29;\
+    }\
+    uint64_t tail = 0;\
+    memcpy(&tail, &data[i], len - i);\
+    return (uint32_t)RBD_MIX(hash ^ tail);\
+  }\
+\
+  /* Construct the string header, copying short characters inline. */\
+  Str *RBD(Str, _consHeader)(Str *str, const char *data, size_t len) {\
+    *str = (Str) {\
+      .len = (uint32_t)len,\
+      .hash = RBD(Str, _hashChars)(data, len),\
+    };\
+    if (len <= RBD_STR_INLINE_LEN) {\
+      memcpy(str->chars, data, len);\
+    }\
+    return str;\
+  }\
+\
+  Str *RBD(Str, _cons)(Str *str, RBD(Str, Arena) *arena, const char *data, size_t len) {\
+    RBD(Str, _consHeader)(str, data, len);\
+    if (len > RBD_STR_INLINE_LEN) {\
+      str->ptr = RBD(Str, Arena_copy)(arena, data, len);\
+    }\
+    return str;\
+  }\
+\
+  Str *RBD(Str, _view)(Str *str, const char *data, size_t len) {\
+    RBD(Str, _consHeader)(str, data, len);\
+    if (len > RBD_STR_INLINE_LEN) {\
+      str->ptr = data;\
+    }\
+    return str;\
+  }\
+\
+  const char *RBD(Str, _data)(Str *str) {\
+    return (str->len <= RBD_STR_INLINE_LEN) ? str->chars : str->ptr;\
+  }\
+\
+  size_t RBD(Str, _len)(Str *str) {\
+    return str->len;\
+  }\
+\
+  size_t RBD(Str, _hash)(Str str) {\
+    return str.hash;\
+  }\
+\
+  bool RBD(Str, _equals)(Str a, Str b) {\
+    if (a.len != b.len || a.hash != b.hash) {\
+      return false;\
+    }\
+    if (a.len <= RBD_STR_INLINE_LEN) {\
+      return !memcmp(a.chars, b.chars, sizeof(a.chars));\
+    }\
+    return a.ptr == b.ptr || !memcmp(a.ptr, b.ptr, a.len);\
+  }\
+\
+  bool RBD(Str, _equalsInterned)(Str a, Str b) {\
+    return a.len == b.len && a.hash == b.hash && !memcmp(a.chars, b.chars, sizeof(a.chars));\
+  }\
+\
+  void RBD(Str, _debug)(Str str, FILE *file, RBD_UNUSED uint32_t depth) {\
+    fprintf(file, #Str " { \"%.*s\" }", (int)str.len, RBD(Str, _data)(&str));\
+  }\
+\
+  /*=================================================================================================================*/\
+  /* String Intern Index                                                                                             */\
+  /*=================================================================================================================*/\
+\
+  RBD_MAP_GEN_DEF(RBD(Str, InternMap), Str, RBD(Str, _hash), RBD(Str, _equals), RBD(Str, _debug), , uint32_t, , , , , Allocator_alloc, Allocator_free)\
+\
+  /*=================================================================================================================*/\
+  /* String Intern Table                                                                                             */\
+  /*=================================================================================================================*/\
+\
+  struct RBD(Str, Intern) {\
+    RBD(Str, InternMap) map;\
+    RBD(Str, Arena) arena;\
+  };\
+\
+  RBD(Str, Intern) *RBD(Str, Intern_cons)(RBD(Str, Intern) *intern, size_t cap) {\
+    RBD(Str, InternMap_cons)(&intern->map, cap);\
+    RBD(Str, Arena_cons)(&intern->arena);\
+    return intern;\
+  }\
+\
+  size_t RBD(Str, Intern_len)(RBD(Str, Intern) *intern) {\
+    return RBD(Str, InternMap_len)(&intern->map);\
+  }\
+\
+  Str RBD(Str, Intern_str)(RBD(Str, Intern) *intern, const char *data, size_t len) {\
+    Str str;\
+    RBD(Str, _view)(&str, data, len);\
+    RBD(Str, InternMapIter) iter = RBD(Str, InternMap_find)(&intern->map, str);\
+    if (!RBD(Str, InternMapIter_equals)(iter, RBD(Str, InternMap_end)(&intern->map))) {\
+      return *RBD(Str, InternMapIter_key)(iter);\
+    }\
+    if (len > RBD_STR_INLINE_LEN) {\
+      str.ptr = RBD(Str, Arena_copy)(&intern->arena, data, len);\
+    }\
+    RBD(Str, InternMap_insert)(&intern->map, str, (uint32_t)RBD(Str, InternMap_len)(&intern->map));\
+    return str;\
+  }\
+\
+  uint32_t RBD(Str, Intern_id)(RBD(Str, Intern) *intern, Str str) {\
+    return *RBD(Str, InternMap_at)(&intern->map, str);\
+  }\
+\
+  void RBD(Str, Intern_debug)(RBD(Str, Intern) *intern, FILE *file, uint32_t depth) {\
+    fprintf(file, #Str "Intern (%p) {\n", intern);\
+    RBD_INDENT(file, depth + 1); fprintf(file, "map: "); RBD(Str, InternMap_debug)(&intern->map, file, depth + 1); fprintf(file, ",\n");\
+    RBD_INDENT(file, depth + 1); fprintf(file, "arena: "); RBD(Str, Arena_debug)(&intern->arena, file, depth + 1); fprintf(file, ",\n");\
+    RBD_INDENT(file, depth); fprintf(file, "}");\
+  }\
+\
+  RBD(Str, Intern) *RBD(Str, Intern_des)(RBD(Str, Intern) *intern) {\
+    RBD(Str, InternMap_des)(&intern->map);\
+    RBD(Str, Arena_des)(&intern->arena);\
+    return intern;\
+  }
+
+#endif // RBD_STR_H